@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <notify-cpp/fanotify.h>
+#include <notify-cpp/inotify.h>
+#include <notify-cpp/notify_controller.h>
+
+#include <time.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+/**
+ * Creates a scratch directory for a workload, on tmpfs if available,
+ * and removes it again.
+ */
+struct BenchDirectory {
+    BenchDirectory(const std::filesystem::path& root, const std::string& name)
+        : path_(root / name)
+    {
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    ~BenchDirectory()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all(path_, ec);
+    }
+
+    std::filesystem::path path_;
+};
+
+inline std::filesystem::path defaultBenchRoot()
+{
+    const std::filesystem::path shm("/dev/shm");
+    if (std::filesystem::is_directory(shm))
+        return shm / "notify-cpp-bench";
+    return std::filesystem::temp_directory_path() / "notify-cpp-bench";
+}
+
+inline void writeFile(const std::filesystem::path& file)
+{
+    std::ofstream stream(file.string(), std::ofstream::out | std::ofstream::trunc);
+    stream << "notify-cpp benchmark payload\n";
+}
+
+inline std::string fileName(std::size_t i)
+{
+    return "file" + std::to_string(i) + ".txt";
+}
+
+inline std::uint64_t monotonicNanoseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+inline std::uint64_t threadCpuNanoseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+
+//! value as a quoted JSON string, error messages contain quotes of std::filesystem::path
+inline std::string jsonString(const std::string& value)
+{
+    std::string json = "\"";
+    for (const char c : value) {
+        switch (c) {
+        case '"':
+            json += "\\\"";
+            break;
+        case '\\':
+            json += "\\\\";
+            break;
+        case '\n':
+            json += "\\n";
+            break;
+        case '\t':
+            json += "\\t";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+                json += escaped;
+            }
+            else {
+                json += c;
+            }
+        }
+    }
+    return json + "\"";
+}
+
+//! The backends selected by --backend, throws std::invalid_argument for unknown names
+inline std::vector<std::string> parseBackends(const std::string& value)
+{
+    if (value == "all")
+        return { "inotify", "fanotify" };
+    if (value == "inotify" || value == "fanotify")
+        return { value };
+    throw std::invalid_argument("Unknown backend: " + value);
+}
+
+/**
+ * Creates a controller of the named backend, the controller throws if it
+ * is not available. The backend is handed to a plain NotifyController,
+ * which can be copied without slicing.
+ */
+inline NotifyController createController(const std::string& backend)
+{
+    if (backend == "fanotify")
+        return NotifyController(new Fanotify);
+    return NotifyController(new Inotify);
+}
+
+/**
+ * Creates a controller watching all given directories. inotify gets a
+ * watch per directory, fanotify marks the mount the directories live on.
+ */
+inline NotifyController createController(const std::string& backend,
+    const std::vector<std::filesystem::path>& directories)
+{
+    if (backend == "fanotify") {
+        auto fanotify = std::make_unique<Fanotify>();
+        if (!directories.empty())
+            fanotify->watchMountPoint({ directories.front(), Event::all });
+        return NotifyController(fanotify.release());
+    }
+
+    NotifyController notifier = createController(backend);
+    for (const auto& directory : directories)
+        notifier.watchDirectory({ directory, Event::all });
+    return notifier;
+}
+
+/**
+ * A directory with numbered files, like FilesystemEventHelper of the
+ * unit tests. The index of a file can be recovered from its path.
+ */
+struct FilesystemBenchHelper : BenchDirectory {
+    FilesystemBenchHelper(const std::filesystem::path& root, const std::string& name, std::size_t files)
+        : BenchDirectory(root, name)
+    {
+        for (std::size_t i = 0; i < files; ++i) {
+            files_.push_back(path_ / fileName(i));
+            writeFile(files_.back());
+        }
+    }
+
+    static std::size_t fileIndex(const std::filesystem::path& file)
+    {
+        return std::stoul(file.filename().string().substr(4));
+    }
+
+    std::vector<std::filesystem::path> files_;
+};
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "allocation_counter.hpp"
+#include "bench_helper.hpp"
+
+#include <notify-cpp/basic_notify_controller.h>
+#include <notify-cpp/fake_notify.h>
+
+#include <cstdlib>
+#include <sstream>
+
+/*
+ * Dispatch cost of the controllers without kernel noise: the events are
+ * injected into a FakeNotify backend up front and dispatched by the
+ * calling thread. The results are written as JSON.
+ *
+ * Usage: notify-cpp-dispatch [--events n] [--output file.json]
+ */
+
+namespace {
+
+const Event MixedEvents[] = { Event::open, Event::modify, Event::close_write, Event::access };
+
+struct Result {
+    std::string controller;
+    std::size_t events = 0;
+    std::size_t handled = 0;
+    double seconds = 0;
+    double allocationsPerEvent = 0;
+};
+
+void inject(FakeNotify& fake, std::size_t events)
+{
+    for (std::size_t i = 0; i < events; ++i)
+        fake.inject({ "/bench/" + fileName(i % 64), MixedEvents[i % 4] });
+}
+
+template <typename Dispatch>
+Result measure(const std::string& controller, std::size_t events, std::size_t& handled, Dispatch dispatch)
+{
+    Result result;
+    result.controller = controller;
+    result.events = events;
+
+    AllocationScope scope;
+    const auto start = monotonicNanoseconds();
+    for (std::size_t i = 0; i < events; ++i)
+        dispatch();
+    result.seconds = static_cast<double>(monotonicNanoseconds() - start) / 1e9;
+    result.allocationsPerEvent = static_cast<double>(scope.count()) / static_cast<double>(events);
+    result.handled = handled;
+    return result;
+}
+
+Result runNotifyController(std::size_t events, std::size_t observers)
+{
+    FakeNotifyController notifier;
+    std::size_t handled = 0;
+    for (std::size_t i = 0; i < observers; ++i)
+        notifier.onEvent(MixedEvents[i % 4] | (i >= 4 ? Event::attrib : Event::none), [&handled](Notification) { ++handled; });
+    notifier.onUnexpectedEvent([&handled](Notification) { ++handled; });
+    inject(notifier.getFakeNotify(), events);
+
+    return measure("NotifyController/" + std::to_string(observers), events, handled, [&notifier]() { notifier.runOnce(); });
+}
+
+Result runPathRoutes(std::size_t events, std::size_t routes)
+{
+    FakeNotifyController notifier;
+    std::size_t handled = 0;
+    for (std::size_t i = 0; i < routes; ++i)
+        notifier.onPath("/bench/tenant" + std::to_string(i), Event::all, [&handled](Notification) { ++handled; });
+    for (std::size_t i = 0; i < events; ++i)
+        notifier.getFakeNotify().inject({ "/bench/tenant" + std::to_string(i % routes) + "/src/" + fileName(i % 64), MixedEvents[i % 4] });
+
+    return measure("NotifyController/onPath/" + std::to_string(routes), events, handled, [&notifier]() { notifier.runOnce(); });
+}
+
+Result runBasicNotifyController(std::size_t events)
+{
+    std::size_t handled = 0;
+    auto notifier = makeNotifyController<FakeNotify>(
+        on<Event::open>([&handled](const Notification&) { ++handled; }),
+        on<Event::modify>([&handled](const Notification&) { ++handled; }),
+        on<Event::close_write>([&handled](const Notification&) { ++handled; }),
+        on<Event::access>([&handled](const Notification&) { ++handled; }));
+    inject(notifier.backend(), events);
+
+    return measure("BasicNotifyController/4", events, handled, [&notifier]() { notifier.runOnce(); });
+}
+
+std::string toJson(const std::vector<Result>& results)
+{
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"dispatch\",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        json << (i ? "," : "") << "\n    {\"controller\": \"" << r.controller << "\""
+             << ", \"events\": " << r.events
+             << ", \"handled\": " << r.handled
+             << ", \"seconds\": " << r.seconds
+             << ", \"events_per_second\": " << (r.seconds > 0 ? r.events / r.seconds : 0)
+             << ", \"allocations_per_event\": " << r.allocationsPerEvent << "}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t events = 1000000;
+    std::string output;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        if (option == "--events")
+            events = std::max<std::size_t>(1, std::stoul(value));
+        else if (option == "--output")
+            output = value;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--events n] [--output file.json]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::vector<Result> results;
+    results.push_back(runNotifyController(events, 1));
+    results.push_back(runNotifyController(events, 8));
+    results.push_back(runPathRoutes(events, 200));
+    results.push_back(runBasicNotifyController(events));
+
+    const std::string json = toJson(results);
+    if (output.empty()) {
+        std::cout << json;
+    }
+    else {
+        std::ofstream stream(output);
+        stream << json;
+    }
+    return EXIT_SUCCESS;
+}
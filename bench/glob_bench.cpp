@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "bench_helper.hpp"
+
+#include <notify-cpp/glob_set.h>
+
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+
+/*
+ * Matching cost of many ignore globs, like generated from .gitignore
+ * trees: one GlobSet with all patterns against one GlobSet per pattern
+ * tried in turn, as a list of single rules would be checked.
+ *
+ * Usage: notify-cpp-glob [--patterns n] [--paths n] [--output file.json]
+ */
+
+namespace {
+
+std::vector<std::string> makePatterns(std::size_t count)
+{
+    std::vector<std::string> patterns;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto n = std::to_string(i);
+        switch (i % 5) {
+        case 0: patterns.push_back("cache" + n); break;
+        case 1: patterns.push_back("*.ext" + n); break;
+        case 2: patterns.push_back("/repo/module" + n + "/build"); break;
+        case 3: patterns.push_back("/repo/module" + n + "/gen*/"); break;
+        default: patterns.push_back("module" + n + "/**/*.tmp"); break;
+        }
+    }
+    return patterns;
+}
+
+std::vector<std::string> makePaths(std::size_t count, std::size_t patterns)
+{
+    std::mt19937_64 random(42);
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto module = std::to_string(random() % (patterns * 2));
+        const char* directory = i % 4 == 0 ? "/build/" : i % 4 == 1 ? "/generated/x/" : "/src/detail/";
+        paths.push_back("/repo/module" + module + directory + fileName(i % 100));
+    }
+    return paths;
+}
+
+struct Result {
+    std::string matcher;
+    std::size_t matched = 0;
+    double seconds = 0;
+};
+
+template <typename Match>
+Result measure(const std::string& matcher, const std::vector<std::string>& paths, Match match)
+{
+    Result result;
+    result.matcher = matcher;
+    const auto start = monotonicNanoseconds();
+    for (const auto& path : paths)
+        result.matched += match(path);
+    result.seconds = static_cast<double>(monotonicNanoseconds() - start) / 1e9;
+    return result;
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t patternCount = 10000;
+    std::size_t pathCount = 100000;
+    std::string output;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        if (option == "--patterns")
+            patternCount = std::max<std::size_t>(1, std::stoul(value));
+        else if (option == "--paths")
+            pathCount = std::max<std::size_t>(1, std::stoul(value));
+        else if (option == "--output")
+            output = value;
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--patterns n] [--paths n] [--output file.json]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto patterns = makePatterns(patternCount);
+    const auto paths = makePaths(pathCount, patternCount);
+
+    const auto compileStart = monotonicNanoseconds();
+    const GlobSet set(patterns);
+    const double compileSeconds = static_cast<double>(monotonicNanoseconds() - compileStart) / 1e9;
+
+    std::vector<std::unique_ptr<GlobSet>> single;
+    for (const auto& pattern : patterns)
+        single.push_back(std::make_unique<GlobSet>(std::vector<std::string> { pattern }));
+
+    // The single pattern loop is quadratic, it only gets a sample of the paths
+    const std::vector<std::string> sample(std::begin(paths), std::begin(paths) + static_cast<std::ptrdiff_t>(std::min<std::size_t>(paths.size(), 1000)));
+
+    std::vector<Result> results;
+    results.push_back(measure("GlobSet", paths, [&set](const std::string& path) { return set.matches(path); }));
+    results.push_back(measure("single", sample, [&single](const std::string& path) {
+        return std::any_of(std::begin(single), std::end(single), [&path](const std::unique_ptr<GlobSet>& glob) { return glob->matches(path); });
+    }));
+
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"glob\",\n  \"patterns\": " << patternCount
+         << ",\n  \"compile_seconds\": " << compileSeconds << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        const auto count = r.matcher == "GlobSet" ? paths.size() : sample.size();
+        json << (i ? "," : "") << "\n    {\"matcher\": \"" << r.matcher << "\""
+             << ", \"paths\": " << count
+             << ", \"matched\": " << r.matched
+             << ", \"seconds\": " << r.seconds
+             << ", \"ns_per_path\": " << r.seconds * 1e9 / static_cast<double>(count) << "}";
+    }
+    json << "\n  ]\n}\n";
+
+    if (output.empty()) {
+        std::cout << json.str();
+    }
+    else {
+        std::ofstream stream(output);
+        stream << json.str();
+    }
+    return EXIT_SUCCESS;
+}
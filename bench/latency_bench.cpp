@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "bench_helper.hpp"
+
+#include <notify-cpp/latency_histogram.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+/*
+ * End-to-end latency from a file write to the EventObserver call. Every
+ * file is written once at a fixed rate, the write is stamped with
+ * CLOCK_MONOTONIC and the observer records the difference on arrival.
+ * The CPU time of the reader thread shows the cost of a spin budget.
+ *
+ * Usage: notify-cpp-latency [--backend inotify|fanotify|all] [--dir path]
+ *                           [--spin microseconds] [--output file.json]
+ */
+
+namespace {
+
+struct Result {
+    std::string backend;
+    std::size_t rate = 0;
+    std::size_t writes = 0;
+    std::size_t received = 0;
+    std::chrono::microseconds spin { 0 };
+    //! CPU time of the reader thread over the wall time of the run
+    double cpuUtilization = 0;
+    std::uint64_t spinHits = 0;
+    std::uint64_t blockingWaits = 0;
+    LatencyHistogram histogram;
+    std::string error;
+};
+
+void runLatency(Result& result, const std::filesystem::path& root)
+{
+    const std::size_t writes = std::min<std::size_t>(result.rate * 2, 5000);
+    FilesystemBenchHelper helper(root, result.backend + "_latency_" + std::to_string(result.rate), writes);
+    result.writes = writes;
+
+    auto writeTimes = std::make_unique<std::atomic<std::uint64_t>[]>(writes);
+    std::atomic<std::size_t> received(0);
+
+    NotifyController notifier;
+    try {
+        notifier = createController(result.backend);
+        notifier.setSpinBudget(result.spin);
+        for (const auto& file : helper.files_)
+            notifier.watchFile({file, Event::close_write});
+    }
+    catch (const std::exception& e) {
+        result.error = e.what();
+        return;
+    }
+
+    notifier.onEvent(Event::close_write, [&](Notification notification) {
+        const auto now = monotonicNanoseconds();
+        const auto written = writeTimes[FilesystemBenchHelper::fileIndex(notification.getPath())].load();
+        if (written != 0 && now > written)
+            result.histogram.record(now - written);
+        ++received;
+    });
+
+    std::uint64_t cpu = 0;
+    const auto started = monotonicNanoseconds();
+    std::thread consumer([&notifier, &cpu]() {
+        const auto start = threadCpuNanoseconds();
+        notifier.run();
+        cpu = threadCpuNanoseconds() - start;
+    });
+
+    const auto interval = std::chrono::nanoseconds(1000000000 / result.rate);
+    auto next = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < writes; ++i) {
+        std::this_thread::sleep_until(next);
+        writeTimes[i] = monotonicNanoseconds();
+        writeFile(helper.files_[i]);
+        next += interval;
+    }
+
+    // Drain: until every write arrived or nothing arrived for a second
+    std::size_t seen = 0;
+    while (received < writes && seen != received) {
+        seen = received;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    notifier.stop();
+    consumer.join();
+    result.received = received;
+    result.cpuUtilization = static_cast<double>(cpu) / static_cast<double>(monotonicNanoseconds() - started);
+
+    const NotifyStats stats = notifier.getStats();
+    result.spinHits = stats.spinHits;
+    result.blockingWaits = stats.blockingWaits;
+}
+
+std::string toJson(const std::vector<std::unique_ptr<Result>>& results)
+{
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"latency\",\n  \"unit\": \"ns\",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = *results[i];
+        json << (i ? "," : "") << "\n    {\"backend\": " << jsonString(r.backend)
+             << ", \"rate\": " << r.rate
+             << ", \"spin_us\": " << r.spin.count();
+        if (!r.error.empty()) {
+            json << ", \"error\": " << jsonString(r.error) << "}";
+            continue;
+        }
+        json << ", \"writes\": " << r.writes
+             << ", \"received\": " << r.received
+             << ", \"p50\": " << r.histogram.percentile(50)
+             << ", \"p90\": " << r.histogram.percentile(90)
+             << ", \"p99\": " << r.histogram.percentile(99)
+             << ", \"p999\": " << r.histogram.percentile(99.9)
+             << ", \"max\": " << r.histogram.max()
+             << ", \"cpu_utilization\": " << r.cpuUtilization
+             << ", \"spin_hits\": " << r.spinHits
+             << ", \"blocking_waits\": " << r.blockingWaits << "}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> backends { "inotify", "fanotify" };
+    const std::vector<std::size_t> rates { 100, 1000, 10000 };
+    std::filesystem::path root = defaultBenchRoot();
+    std::string output;
+    std::chrono::microseconds spin { 0 };
+
+    const auto usage = [&argv]() {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--backend inotify|fanotify|all] [--dir path] [--spin microseconds] [--output file.json]" << std::endl;
+        return EXIT_FAILURE;
+    };
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc)
+            return usage();
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        try {
+            if (option == "--backend")
+                backends = parseBackends(value);
+            else if (option == "--dir")
+                root = value;
+            else if (option == "--spin")
+                spin = std::chrono::microseconds(std::stoll(value));
+            else if (option == "--output")
+                output = value;
+            else
+                return usage();
+        }
+        catch (const std::exception&) {
+            return usage();
+        }
+    }
+
+    // The histograms are too large for the stack
+    std::vector<std::unique_ptr<Result>> results;
+    for (const auto& backend : backends) {
+        for (const auto rate : rates) {
+            std::cerr << "running " << backend << " at " << rate << " writes/s" << std::endl;
+            results.push_back(std::make_unique<Result>());
+            results.back()->backend = backend;
+            results.back()->rate = rate;
+            results.back()->spin = spin;
+            runLatency(*results.back(), root);
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(root, ec);
+
+    const std::string json = toJson(results);
+    if (output.empty()) {
+        std::cout << json;
+    }
+    else {
+        std::ofstream stream(output);
+        stream << json;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "allocation_counter.hpp"
+#include "bench_helper.hpp"
+
+#include <notify-cpp/event_journal.h>
+
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+/*
+ * Records the events below a directory to an EventJournal and plays a
+ * recorded journal back through a NotifyController, so handlers can be
+ * measured against the shape of real traffic.
+ *
+ * Usage: notify-cpp-replay record --journal dir --dir path [--backend inotify|fanotify] [--seconds n]
+ *        notify-cpp-replay replay --journal dir [--speed x] [--output file.json]
+ *
+ * A speed of 1 keeps the recorded timing, 0 replays as fast as possible.
+ */
+
+namespace {
+
+int usage(const char* name)
+{
+    std::cerr << "Usage: " << name << " record --journal dir --dir path [--backend inotify|fanotify] [--seconds n]\n"
+              << "       " << name << " replay --journal dir [--speed x] [--output file.json]" << std::endl;
+    return EXIT_FAILURE;
+}
+
+int record(const std::filesystem::path& journalPath, const std::filesystem::path& root, const std::string& backend, std::size_t seconds)
+{
+    std::vector<std::filesystem::path> directories { root };
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root, std::filesystem::directory_options::skip_permission_denied)) {
+        if (entry.is_directory())
+            directories.push_back(entry.path());
+    }
+
+    auto journal = std::make_shared<EventJournal>(journalPath);
+    const auto first = journal->getLastSequence() + 1;
+
+    NotifyController notifier = createController(backend, directories);
+    notifier.setJournal(journal);
+
+    std::thread consumer([&notifier]() { notifier.run(); });
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    notifier.stop();
+    consumer.join();
+    journal->sync();
+
+    std::cerr << "recorded " << journal->getLastSequence() + 1 - first << " events of " << directories.size()
+              << " directories" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int replay(const std::filesystem::path& journalPath, double speed, const std::string& output)
+{
+    EventJournal journal(journalPath);
+    ReplayOptions options;
+    options.speed = speed;
+    ReplayNotifyController notifier(journal, options);
+
+    std::size_t handled = 0;
+    notifier.onUnexpectedEvent([&handled](Notification) { ++handled; });
+
+    AllocationScope scope;
+    const auto start = monotonicNanoseconds();
+    const auto startCpu = threadCpuNanoseconds();
+    notifier.run();
+    const double seconds = static_cast<double>(monotonicNanoseconds() - start) / 1e9;
+    const double cpuSeconds = static_cast<double>(threadCpuNanoseconds() - startCpu) / 1e9;
+    const auto allocations = scope.count();
+
+    const double events = static_cast<double>(std::max<std::size_t>(handled, 1));
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"replay\",\n  \"speed\": " << speed
+         << ",\n  \"events\": " << handled
+         << ",\n  \"seconds\": " << seconds
+         << ",\n  \"events_per_second\": " << (seconds > 0 ? handled / seconds : 0)
+         << ",\n  \"cpu_ns_per_event\": " << cpuSeconds * 1e9 / events
+         << ",\n  \"allocations_per_event\": " << static_cast<double>(allocations) / events << "\n}\n";
+
+    if (output.empty()) {
+        std::cout << json.str();
+    }
+    else {
+        std::ofstream stream(output);
+        stream << json.str();
+    }
+    return EXIT_SUCCESS;
+}
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+        return usage(argv[0]);
+
+    const std::string mode(argv[1]);
+    std::filesystem::path journal;
+    std::filesystem::path root;
+    std::string backend = "inotify";
+    std::string output;
+    std::size_t seconds = 10;
+    double speed = 0;
+
+    for (int i = 2; i < argc; i += 2) {
+        if (i + 1 == argc)
+            return usage(argv[0]);
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        if (option == "--journal")
+            journal = value;
+        else if (option == "--dir")
+            root = value;
+        else if (option == "--backend" && (value == "inotify" || value == "fanotify"))
+            backend = value;
+        else if (option == "--seconds")
+            seconds = std::stoul(value);
+        else if (option == "--speed")
+            speed = std::stod(value);
+        else if (option == "--output")
+            output = value;
+        else
+            return usage(argv[0]);
+    }
+
+    if (journal.empty())
+        return usage(argv[0]);
+
+    try {
+        if (mode == "record" && !root.empty())
+            return record(journal, root, backend, seconds);
+        if (mode == "replay")
+            return replay(journal, speed, output);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return usage(argv[0]);
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "allocation_counter.hpp"
+#include "bench_helper.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+#include <thread>
+
+/*
+ * Event throughput of the inotify and fanotify controllers under
+ * reproducible file system workloads. Every workload is run against a
+ * fresh controller, the results are written as JSON.
+ *
+ * Usage: notify-cpp-bench [--backend inotify|fanotify|all] [--dir path]
+ *                         [--scale n] [--output file.json]
+ */
+
+namespace {
+
+struct Workload {
+    std::string name;
+    //! prepare the directory, return the directories to watch
+    std::function<std::vector<std::filesystem::path>(const std::filesystem::path&)> setup;
+    //! run the workload, return the number of file system operations
+    std::function<std::size_t(const std::filesystem::path&)> run;
+    //! create, delete and rename events need FAN_REPORT_FID with fanotify
+    bool needsFid = false;
+};
+
+struct Result {
+    std::string backend;
+    std::string workload;
+    std::size_t operations = 0;
+    std::size_t events = 0;
+    double seconds = 0;
+    double cpuNanosecondsPerEvent = 0;
+    double allocationsPerEvent = 0;
+    std::string error;
+    //! the backend can't observe the workload, no numbers are reported
+    std::string unsupported;
+};
+
+std::vector<Workload> createWorkloads(std::size_t scale)
+{
+    const std::size_t files = 1000 * scale;
+
+    std::vector<Workload> workloads;
+
+    workloads.push_back({ "file_churn",
+        [files](const std::filesystem::path& dir) {
+            for (std::size_t i = 0; i < files / 10; ++i)
+                writeFile(dir / fileName(i));
+            return std::vector<std::filesystem::path> { dir };
+        },
+        [files](const std::filesystem::path& dir) {
+            for (std::size_t round = 0; round < 10; ++round)
+                for (std::size_t i = 0; i < files / 10; ++i)
+                    writeFile(dir / fileName(i));
+            return files;
+        } });
+
+    workloads.push_back({ "bulk_create_delete",
+        [](const std::filesystem::path& dir) {
+            return std::vector<std::filesystem::path> { dir };
+        },
+        [files](const std::filesystem::path& dir) {
+            for (std::size_t i = 0; i < files; ++i)
+                writeFile(dir / fileName(i));
+            for (std::size_t i = 0; i < files; ++i)
+                std::filesystem::remove(dir / fileName(i));
+            return 2 * files;
+        },
+        true });
+
+    workloads.push_back({ "rename_storm",
+        [files](const std::filesystem::path& dir) {
+            for (std::size_t i = 0; i < files / 10; ++i)
+                writeFile(dir / fileName(i));
+            return std::vector<std::filesystem::path> { dir };
+        },
+        [files](const std::filesystem::path& dir) {
+            for (std::size_t round = 0; round < 5; ++round) {
+                for (std::size_t i = 0; i < files / 10; ++i)
+                    std::filesystem::rename(dir / fileName(i), dir / ("renamed_" + fileName(i)));
+                for (std::size_t i = 0; i < files / 10; ++i)
+                    std::filesystem::rename(dir / ("renamed_" + fileName(i)), dir / fileName(i));
+            }
+            return files;
+        },
+        true });
+
+    // A source tree checkout: many directories, a few files each
+    workloads.push_back({ "tree_checkout",
+        [scale](const std::filesystem::path& dir) {
+            std::vector<std::filesystem::path> directories { dir };
+            for (std::size_t a = 0; a < 16 * scale; ++a) {
+                for (std::size_t b = 0; b < 8; ++b) {
+                    const auto sub = dir / ("module" + std::to_string(a)) / ("src" + std::to_string(b));
+                    std::filesystem::create_directories(sub);
+                    directories.push_back(sub.parent_path());
+                    directories.push_back(sub);
+                }
+            }
+            return directories;
+        },
+        [scale](const std::filesystem::path& dir) {
+            std::size_t operations = 0;
+            for (std::size_t a = 0; a < 16 * scale; ++a) {
+                for (std::size_t b = 0; b < 8; ++b) {
+                    const auto sub = dir / ("module" + std::to_string(a)) / ("src" + std::to_string(b));
+                    for (std::size_t f = 0; f < 8; ++f, ++operations)
+                        writeFile(sub / fileName(f));
+                }
+            }
+            return operations;
+        } });
+
+    return workloads;
+}
+
+Result runWorkload(const std::string& backend, const Workload& workload, const std::filesystem::path& root)
+{
+    Result result;
+    result.backend = backend;
+    result.workload = workload.name;
+
+    if (backend == "fanotify" && workload.needsFid) {
+        result.unsupported = "needs FAN_REPORT_FID";
+        return result;
+    }
+
+    BenchDirectory dir(root, backend + "_" + workload.name);
+    const auto directories = workload.setup(dir.path_);
+
+    NotifyController notifier;
+    try {
+        notifier = createController(backend, directories);
+    }
+    catch (const std::exception& e) {
+        result.error = e.what();
+        return result;
+    }
+
+    std::atomic<std::size_t> events(0);
+    std::atomic<std::int64_t> lastEvent(0);
+    const auto count = [&](Notification) {
+        ++events;
+        lastEvent = std::chrono::steady_clock::now().time_since_epoch().count();
+    };
+    notifier.onEvent(Event::all, count).onUnexpectedEvent(count);
+
+    std::uint64_t cpuNanoseconds = 0;
+    std::size_t allocations = 0;
+    std::thread consumer([&]() {
+        AllocationScope scope;
+        const auto cpuStart = threadCpuNanoseconds();
+        notifier.run();
+        cpuNanoseconds = threadCpuNanoseconds() - cpuStart;
+        allocations = scope.count();
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    result.operations = workload.run(dir.path_);
+
+    // Drain: wait until no event arrived for a second
+    std::size_t seen = 0;
+    do {
+        seen = events;
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    } while (seen != events);
+
+    notifier.stop();
+    consumer.join();
+
+    const auto end = lastEvent.load() != 0
+        ? std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(lastEvent.load()))
+        : std::chrono::steady_clock::now();
+
+    result.events = events;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    if (result.events > 0) {
+        result.cpuNanosecondsPerEvent = static_cast<double>(cpuNanoseconds) / result.events;
+        result.allocationsPerEvent = static_cast<double>(allocations) / result.events;
+    }
+    return result;
+}
+
+std::string toJson(const std::vector<Result>& results)
+{
+    std::ostringstream json;
+    json << "{\n  \"benchmark\": \"throughput\",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        json << (i ? "," : "") << "\n    {\"backend\": " << jsonString(r.backend)
+             << ", \"workload\": " << jsonString(r.workload);
+        if (!r.error.empty()) {
+            json << ", \"error\": " << jsonString(r.error) << "}";
+            continue;
+        }
+        if (!r.unsupported.empty()) {
+            json << ", \"unsupported\": " << jsonString(r.unsupported) << "}";
+            continue;
+        }
+        json << ", \"operations\": " << r.operations
+             << ", \"events\": " << r.events
+             << ", \"seconds\": " << r.seconds
+             << ", \"events_per_second\": " << (r.seconds > 0 ? r.events / r.seconds : 0)
+             << ", \"cpu_ns_per_event\": " << r.cpuNanosecondsPerEvent
+             << ", \"allocations_per_event\": " << r.allocationsPerEvent << "}";
+    }
+    json << "\n  ]\n}\n";
+    return json.str();
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> backends { "inotify", "fanotify" };
+    std::filesystem::path root = defaultBenchRoot();
+    std::size_t scale = 1;
+    std::string output;
+
+    const auto usage = [&argv]() {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--backend inotify|fanotify|all] [--dir path] [--scale n] [--output file.json]" << std::endl;
+        return EXIT_FAILURE;
+    };
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc)
+            return usage();
+        const std::string option(argv[i]);
+        const std::string value(argv[i + 1]);
+        try {
+            if (option == "--backend")
+                backends = parseBackends(value);
+            else if (option == "--dir")
+                root = value;
+            else if (option == "--scale")
+                scale = std::max<std::size_t>(1, std::stoul(value));
+            else if (option == "--output")
+                output = value;
+            else
+                return usage();
+        }
+        catch (const std::exception&) {
+            return usage();
+        }
+    }
+
+    std::vector<Result> results;
+    for (const auto& backend : backends) {
+        for (const auto& workload : createWorkloads(scale)) {
+            std::cerr << "running " << backend << " " << workload.name << std::endl;
+            results.push_back(runWorkload(backend, workload, root));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(root, ec);
+
+    const std::string json = toJson(results);
+    if (output.empty()) {
+        std::cout << json;
+    }
+    else {
+        std::ofstream stream(output);
+        stream << json;
+    }
+    return EXIT_SUCCESS;
+}
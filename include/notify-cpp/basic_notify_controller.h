@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <notify-cpp/event.h>
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/notification.h>
+#include <notify-cpp/pipeline_timing.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace notifycpp {
+
+/**
+ * @brief Binds a handler to the Event it observes, @see on()
+ */
+template <Event E, typename Handler>
+struct EventBinding {
+    static constexpr Event event = E;
+    Handler handler;
+};
+
+template <Event E, typename Handler>
+EventBinding<E, std::decay_t<Handler>> on(Handler&& handler)
+{
+    return { std::forward<Handler>(handler) };
+}
+
+/**
+ * @brief Statically dispatched counterpart of NotifyController
+ *
+ * The backend and all handlers are part of the type. getNextEvent is
+ * called non-virtually, but it is still an out-of-line function of the
+ * library. Only the dispatch to the handlers is static: they are called
+ * directly instead of through std::function and can be inlined. Like
+ * with NotifyController a handler is called if it was bound to all bits
+ * of the event.
+ *
+ * @code
+ * auto notifier = makeNotifyController<Inotify>(
+ *     on<Event::close_write>([](const Notification& n) { ... }),
+ *     on<Event::open>([](const Notification& n) { ... }));
+ * notifier.watchFile({path, Event::open | Event::close_write});
+ * notifier.run();
+ * @endcode
+ */
+template <typename Backend, typename... Bindings>
+class BasicNotifyController {
+public:
+    explicit BasicNotifyController(Bindings... bindings)
+        : _Bindings(std::move(bindings)...)
+    {
+    }
+
+    BasicNotifyController(const BasicNotifyController&) = delete;
+    BasicNotifyController& operator=(const BasicNotifyController&) = delete;
+
+    Backend& backend()
+    {
+        return _Backend;
+    }
+
+    void run()
+    {
+        while (!_Backend.hasStopped())
+            runOnce();
+    }
+
+    void runOnce()
+    {
+        const auto fileSystemEvent = _Backend.Backend::getNextEvent();
+        if (!fileSystemEvent)
+            return;
+        const auto dispatched = pipelineClock();
+
+        const Event event = fileSystemEvent->getEvent();
+        const std::size_t invoked = std::apply(
+            [&](auto&... binding) { return (std::size_t(0) + ... + dispatch(binding, event, *fileSystemEvent)); },
+            _Bindings);
+        _Backend.countObserverInvocations(invoked);
+
+        _Backend.recordPipelineTiming(*fileSystemEvent, dispatched);
+    }
+
+    void stop()
+    {
+        _Backend.stop();
+    }
+
+    BasicNotifyController& watchFile(const FileSystemEvent& fse)
+    {
+        _Backend.watchFile(fse);
+        return *this;
+    }
+
+    BasicNotifyController& watchPathRecursively(const FileSystemEvent& fse)
+    {
+        _Backend.watchPathRecursively(fse);
+        return *this;
+    }
+
+    BasicNotifyController& unwatch(const std::filesystem::path& p)
+    {
+        _Backend.unwatch(p);
+        return *this;
+    }
+
+    BasicNotifyController& ignore(const std::filesystem::path& p)
+    {
+        _Backend.ignore(p);
+        return *this;
+    }
+
+    BasicNotifyController& ignoreOnce(const std::filesystem::path& p)
+    {
+        _Backend.ignoreOnce(p);
+        return *this;
+    }
+
+private:
+    template <typename Binding>
+    static std::size_t dispatch(Binding& binding, Event event, const FileSystemEvent& fse)
+    {
+        if ((Binding::event & event) != event)
+            return 0;
+        binding.handler(Notification(Binding::event, fse));
+        return 1;
+    }
+
+    Backend _Backend;
+    std::tuple<Bindings...> _Bindings;
+};
+
+template <typename Backend, typename... Bindings>
+BasicNotifyController<Backend, Bindings...> makeNotifyController(Bindings... bindings)
+{
+    return BasicNotifyController<Backend, Bindings...>(std::move(bindings)...);
+}
+}
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
-#include <functional>
 #include <iostream>
+#include <string>
 #include <linux/version.h>
 #include <sys/fanotify.h>
+#include <sys/inotify.h>
 #include <type_traits>
 #include <vector>
 
@@ -108,6 +110,105 @@ struct EnableBitMaskOperators<Event> {
     static const bool enable = true;
 };
 
+//! Number of distinct Event masks, every Event fits into its lower 13 bits
+static constexpr std::size_t EventMaskSpace = static_cast<std::size_t>(Event::none) << 1;
+
+struct EventFlag {
+    Event event;
+    std::uint32_t inotify;
+    //! 0 if fanotify can't report the event without FAN_REPORT_FID
+    std::uint32_t fanotify;
+};
+
+static constexpr std::array<EventFlag, 12> EventFlags = {{{Event::access, IN_ACCESS, FAN_ACCESS},
+    {Event::modify, IN_MODIFY, FAN_MODIFY},
+    {Event::attrib, IN_ATTRIB, 0},
+    {Event::close_write, IN_CLOSE_WRITE, FAN_CLOSE_WRITE},
+    {Event::close_nowrite, IN_CLOSE_NOWRITE, FAN_CLOSE_NOWRITE},
+    {Event::open, IN_OPEN, FAN_OPEN},
+    {Event::moved_from, IN_MOVED_FROM, 0},
+    {Event::moved_to, IN_MOVED_TO, 0},
+    {Event::create, IN_CREATE, 0},
+    {Event::delete_sub, IN_DELETE, 0},
+    {Event::delete_self, IN_DELETE_SELF, 0},
+    {Event::move_self, IN_MOVE_SELF, 0}}};
+
+/**
+ * Translation between Event and kernel masks by two lookups into tables
+ * of 64 entries, one for the lower and one for the upper six bits. The
+ * tables are generated at compile time from EventFlags, bits without a
+ * counterpart like IN_ISDIR are dropped.
+ */
+namespace detail {
+    using MaskTable = std::array<std::uint32_t, 64>;
+
+    template <typename From, typename To>
+    constexpr MaskTable makeMaskTable(From from, To to, std::uint32_t shift)
+    {
+        MaskTable table {};
+        for (std::uint32_t chunk = 0; chunk < table.size(); ++chunk) {
+            for (const auto& flag : EventFlags) {
+                const std::uint32_t bit = from(flag) >> shift;
+                if (bit != 0 && bit < table.size() && (bit << shift) == from(flag) && (chunk & bit) != 0)
+                    table[chunk] |= to(flag);
+            }
+        }
+        return table;
+    }
+
+    constexpr std::uint32_t eventBits(const EventFlag& flag) { return static_cast<std::uint32_t>(flag.event); }
+    constexpr std::uint32_t inotifyBits(const EventFlag& flag) { return flag.inotify; }
+    constexpr std::uint32_t fanotifyBits(const EventFlag& flag) { return flag.fanotify; }
+
+    static constexpr MaskTable EventToInotifyLow = makeMaskTable(eventBits, inotifyBits, 0);
+    static constexpr MaskTable EventToInotifyHigh = makeMaskTable(eventBits, inotifyBits, 6);
+    static constexpr MaskTable EventToFanotifyLow = makeMaskTable(eventBits, fanotifyBits, 0);
+    static constexpr MaskTable EventToFanotifyHigh = makeMaskTable(eventBits, fanotifyBits, 6);
+    static constexpr MaskTable InotifyToEventLow = makeMaskTable(inotifyBits, eventBits, 0);
+    static constexpr MaskTable InotifyToEventHigh = makeMaskTable(inotifyBits, eventBits, 6);
+    static constexpr MaskTable FanotifyToEventLow = makeMaskTable(fanotifyBits, eventBits, 0);
+    static constexpr MaskTable FanotifyToEventHigh = makeMaskTable(fanotifyBits, eventBits, 6);
+
+    constexpr std::uint32_t lookup(const MaskTable& low, const MaskTable& high, std::uint32_t mask)
+    {
+        return low[mask & 63] | high[(mask >> 6) & 63];
+    }
+
+    constexpr Event toEvent(std::uint32_t bits)
+    {
+        return bits == 0 ? Event::none : static_cast<Event>(bits);
+    }
+}
+
+constexpr std::uint32_t toInotifyMask(const Event event)
+{
+    return detail::lookup(detail::EventToInotifyLow, detail::EventToInotifyHigh, static_cast<std::uint32_t>(event));
+}
+
+constexpr std::uint32_t toFanotifyMask(const Event event)
+{
+    return detail::lookup(detail::EventToFanotifyLow, detail::EventToFanotifyHigh, static_cast<std::uint32_t>(event));
+}
+
+//! @return all events of a combined inotify mask or Event::none
+constexpr Event fromInotifyMask(std::uint32_t mask)
+{
+    return detail::toEvent(detail::lookup(detail::InotifyToEventLow, detail::InotifyToEventHigh, mask));
+}
+
+//! @return all events of a combined fanotify mask or Event::none
+constexpr Event fromFanotifyMask(std::uint32_t mask)
+{
+    return detail::toEvent(detail::lookup(detail::FanotifyToEventLow, detail::FanotifyToEventHigh, mask));
+}
+
+static_assert(toInotifyMask(Event::all) == IN_ALL_EVENTS, "inotify table is incomplete");
+static_assert(toInotifyMask(Event::none) == 0, "Event::none has no inotify mask");
+static_assert(fromInotifyMask(IN_CREATE | IN_ISDIR) == Event::create, "IN_ISDIR must not hide the event");
+static_assert(fromInotifyMask(IN_CLOSE) == Event::close, "combined masks decode bitwise");
+static_assert(toFanotifyMask(Event::close) == FAN_CLOSE, "fanotify table is incomplete");
+static_assert(fromFanotifyMask(FAN_OPEN | FAN_ONDIR) == Event::open, "FAN_ONDIR must not hide the event");
+
 class EventHandler {
 public:
     EventHandler() = default;
@@ -127,9 +228,6 @@ public:
     Event getInotify(std::uint32_t) const;
 
     Event getFanotify(std::uint32_t) const;
-
-private:
-    std::uint32_t convert(const Event, std::function<std::uint32_t(Event)>) const;
 };
 
 std::string toString(const Event);
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <notify-cpp/event.h>
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/glob_set.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Filter expression compiled to bytecode
+ *
+ * The filter runs on the path and Event of a decoded kernel record,
+ * before a FileSystemEvent is allocated, so rejected events cost no
+ * allocation and no observer call.
+ *
+ * Grammar:
+ *   expr      := term ('||' term)*
+ *   term      := factor ('&&' factor)*
+ *   factor    := '!' factor | '(' expr ')' | predicate
+ *   predicate := 'ext' 'in' '{' word (',' word)* '}' | 'ext' '==' word
+ *              | 'name' '==' word | 'under' '(' word ')'
+ *              | 'glob' '(' word (',' word)* ')'
+ *              | 'event' '&' events | 'event' '==' events
+ *              | 'size' ('<' | '<=' | '>' | '>=' | '==' | '!=') number
+ *              | 'true' | 'false'
+ *   events    := name | '(' name ('|' name)* ')'
+ *
+ * A word is an identifier or a quoted string, a number may end with k,
+ * M or G. The patterns of one glob() are matched together by a GlobSet.
+ * Example: ext in {cpp,h} && under("/src") && event & (modify|close_write)
+ *
+ * Operands are evaluated left to right and short-circuit. Only size
+ * needs a stat() of the file, so it is best written last. A file which
+ * is gone has no size and fails every size comparison.
+ */
+class EventFilter {
+public:
+    //! @throws std::invalid_argument on a syntax error
+    explicit EventFilter(const std::string& expression);
+
+    bool matches(std::string_view path, Event) const;
+    bool matches(const FileSystemEvent&) const;
+
+    const std::string& getExpression() const;
+
+    //! number of compiled instructions
+    std::size_t size() const;
+
+private:
+    enum class OpCode : std::uint8_t {
+        constant,
+        extensionIn,
+        nameEquals,
+        under,
+        glob,
+        eventAny,
+        eventEquals,
+        sizeCompare,
+        jumpIfFalse,
+        jumpIfTrue,
+        negate
+    };
+
+    enum class Compare : std::uint8_t { less, lessEqual, greater, greaterEqual, equal, notEqual };
+
+    struct Instruction {
+        OpCode op;
+        Compare compare;
+        //! jump target, index into _Sets, _Strings or _Globs, or event mask
+        std::uint32_t operand;
+        std::uint64_t value;
+    };
+
+    class Compiler;
+
+    std::string _Expression;
+    std::vector<Instruction> _Code;
+    //! sorted extensions of extensionIn
+    std::vector<std::vector<std::string>> _Sets;
+    std::vector<std::string> _Strings;
+    std::vector<std::shared_ptr<const GlobSet>> _Globs;
+};
+
+using TEventFilterPtr = std::shared_ptr<const EventFilter>;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <vector>
+
+namespace notifycpp {
+
+struct JournalRecord {
+    std::uint64_t sequence;
+    //! CLOCK_REALTIME in nanoseconds when the record was appended
+    std::uint64_t timestamp;
+    FileSystemEvent event;
+};
+
+using JournalObserver = std::function<void(const JournalRecord&)>;
+
+struct EventJournalOptions {
+    //! bytes per segment file, a segment is rotated when the next record does not fit
+    std::size_t segmentSize = 64 * 1024 * 1024;
+    //! oldest segments are removed beyond this count, 0 keeps all
+    std::size_t maxSegments = 0;
+};
+
+/**
+ * @brief Append-only, memory-mapped log of FileSystemEvents
+ *
+ * The journal is a directory of preallocated segment files named after
+ * their first sequence number. Records are appended to the mapped
+ * segment and become visible once their size field is stored, so a
+ * crash of the process never leaves a torn record behind. sync() writes
+ * the records appended so far to disk. Every record carries a CRC32: if
+ * the machine fails before, a torn record is detected and replay and
+ * appending stop at the first bad record, the records after it are lost.
+ *
+ * Segment layout: "NCPPJRN2", first sequence (uint64), records. Record
+ * layout, 8 byte aligned: size (uint32, 0 ends the segment), crc
+ * (uint32), sequence (uint64), timestamp (uint64), event (uint32), pid
+ * (int32), path length (uint32), reserved (uint32), path.
+ *
+ * One thread may append while other threads replay.
+ */
+class EventJournal {
+public:
+    EventJournal(const std::filesystem::path&, const EventJournalOptions& = EventJournalOptions());
+    ~EventJournal();
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    //! @return sequence number of the record, starting at 1
+    std::uint64_t append(const FileSystemEvent&);
+
+    //! sequence of the last appended record, 0 if empty
+    std::uint64_t getLastSequence() const;
+
+    //! write the current segment to disk, the records appended so far survive a power loss
+    void sync();
+
+    /**
+     * @brief Call observer for every record with a sequence >= from, up
+     *        to the first record with a bad CRC
+     * @return sequence of the last replayed record, 0 if none
+     */
+    std::uint64_t replay(std::uint64_t from, const JournalObserver&) const;
+
+private:
+    std::vector<std::filesystem::path> getSegments() const;
+    void openSegment(const std::filesystem::path&, bool create, std::uint64_t firstSequence);
+    void closeSegment();
+    void rotate();
+    void recover();
+
+    std::filesystem::path _Directory;
+    EventJournalOptions _Options;
+
+    char* _Segment = nullptr;
+    std::size_t _SegmentSize = 0;
+    std::size_t _SegmentOffset = 0;
+    std::uint64_t _LastSequence = 0;
+};
+}
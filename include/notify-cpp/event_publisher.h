@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <notify-cpp/event.h>
+#include <notify-cpp/event_filter.h>
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/notification.h>
+#include <notify-cpp/thread_options.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace notifycpp {
+
+//! What a subscriber does with an event when its queue is full
+enum class SubscriberOverflow {
+    //! drop the new event
+    dropNewest,
+    //! drop the oldest queued event
+    dropOldest,
+    //! wait for space, a slow subscriber then slows down the reader
+    block
+};
+
+struct SubscriberOptions {
+    //! events the subscriber gets, matched like NotifyController::onEvent
+    Event event = Event::all;
+    //! path prefixes the subscriber gets, empty for all paths
+    std::vector<std::filesystem::path> paths;
+    std::size_t queueSize = 4096;
+    SubscriberOverflow overflow = SubscriberOverflow::dropNewest;
+    //! evaluated after event and paths, nullptr accepts all
+    TEventFilterPtr filter;
+    //! affinity and scheduling of the subscriber thread, best effort
+    ThreadOptions thread;
+};
+
+/**
+ * @brief One consumer of an EventPublisher with its own filter, bounded
+ *        queue and dispatch thread
+ *
+ * The events are shared with the other subscribers, not copied. The
+ * observer is called on the thread of the subscriber in the order the
+ * events were published. An exception of the observer is counted in
+ * getFailed() and the subscriber continues with the next event. The
+ * observer may unsubscribe and release its own subscriber.
+ */
+class Subscriber {
+public:
+    Subscriber(const SubscriberOptions&, EventObserver);
+    ~Subscriber();
+
+    Subscriber(const Subscriber&) = delete;
+    Subscriber& operator=(const Subscriber&) = delete;
+
+    bool matches(const FileSystemEvent&) const;
+
+    //! queue an event, called by the publisher
+    void push(const TFileSystemEventPtr&);
+
+    /**
+     * @brief Deliver the queued events and join the thread, later events
+     *        are dropped. Called by the observer, the thread is detached
+     *        and ends after the queued events.
+     */
+    void close();
+
+    std::uint64_t getDelivered() const;
+    std::uint64_t getDropped() const;
+    //! events whose observer threw
+    std::uint64_t getFailed() const;
+    std::size_t getPending() const;
+
+private:
+    struct Channel;
+
+    static void run(const std::shared_ptr<Channel>&);
+
+    SubscriberOptions _Options;
+    //! _Options.paths without trailing separators
+    std::vector<std::string> _Prefixes;
+
+    //! queue, counters and observer, shared with the thread so that it
+    //! may outlive a subscriber released by its own observer
+    std::shared_ptr<Channel> _Channel;
+
+    std::thread _Thread;
+};
+
+using TSubscriberPtr = std::shared_ptr<Subscriber>;
+
+/**
+ * @brief Fan-out of one decoded event stream to many subscribers
+ *
+ * publish() only filters and queues, so a slow subscriber does not delay
+ * the reader or the other subscribers unless it asks to block. The list
+ * of subscribers is replaced on change and read without a lock.
+ */
+class EventPublisher {
+public:
+    EventPublisher();
+    ~EventPublisher();
+
+    EventPublisher(const EventPublisher&) = delete;
+    EventPublisher& operator=(const EventPublisher&) = delete;
+
+    TSubscriberPtr subscribe(const SubscriberOptions&, EventObserver);
+
+    //! remove and close the subscriber
+    void unsubscribe(const TSubscriberPtr&);
+
+    void publish(const TFileSystemEventPtr&) const;
+
+    std::size_t size() const;
+
+private:
+    using Subscribers = std::vector<TSubscriberPtr>;
+
+    std::mutex _Mutex;
+    std::shared_ptr<const Subscribers> _Subscribers;
+};
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/notify.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief In-memory backend for tests and benchmarks
+ *
+ * Events are injected instead of read from the kernel. Every event is
+ * due at a point of a virtual clock which only moves with advance(),
+ * so the order and timing of the delivered events is deterministic.
+ * getNextEvent() blocks until an event is due or stop() is called.
+ * Overflows of the kernel queue and reordering are simulated on demand.
+ * All methods except getNextEvent() may be called from any thread.
+ */
+class FakeNotify : public Notify {
+public:
+    FakeNotify();
+
+    virtual void watchFile(const FileSystemEvent&) override;
+    virtual void watchDirectory(const FileSystemEvent&) override;
+    virtual void unwatch(const FileSystemEvent&) override;
+    virtual TFileSystemEventPtr getNextEvent() override;
+    virtual std::uint32_t getEventMask(const Event) const override;
+    virtual void stop() override;
+
+    bool isWatched(const std::filesystem::path&) const;
+
+    //! queue an event due after delay on the virtual clock
+    void inject(const FileSystemEvent&, std::chrono::nanoseconds delay = std::chrono::nanoseconds(0));
+
+    //! queue count copies of an event, spaced to arrive at perSecond on the virtual clock
+    void injectAtRate(const FileSystemEvent&, std::size_t count, double perSecond);
+
+    void advance(std::chrono::nanoseconds);
+    std::chrono::nanoseconds now() const;
+
+    /**
+     * Like max_queued_events of inotify: events injected while limit
+     * events are pending are dropped and counted as one overflow.
+     * 0 disables the limit.
+     */
+    void setQueueLimit(std::size_t);
+
+    //! drop all pending events and count an overflow
+    void overflow();
+
+    //! shuffle the events which are due now, the same seed gives the same order
+    void reorder(std::uint64_t seed);
+
+    std::size_t pending() const;
+
+private:
+    struct Pending {
+        std::chrono::nanoseconds due;
+        TFileSystemEventPtr event;
+    };
+
+    void insert(std::chrono::nanoseconds due, const FileSystemEvent&);
+    bool isDue() const;
+
+    mutable std::mutex _Mutex;
+    std::condition_variable _Wakeup;
+
+    //! ordered by due time, events with the same time in injection order
+    std::deque<Pending> _Pending;
+    std::chrono::nanoseconds _Now;
+    std::size_t _QueueLimit;
+    bool _Overflowed;
+
+    std::set<std::filesystem::path> _Watches;
+};
+}
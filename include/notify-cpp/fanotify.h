@@ -25,8 +25,12 @@
 
 #include <notify-cpp/file_system_event.h>
 #include <notify-cpp/notify.h>
+#include <notify-cpp/process_info.h>
 
+#include <cstddef>
 #include <filesystem>
+#include <functional>
+#include <memory>
 
 /**
  * @brief C++ wrapper for linux fanotify interface
@@ -44,26 +48,99 @@
  */
 namespace notifycpp {
 
+/**
+ * Notification class of the fanotify group, see fanotify_init(2).
+ * With content or pre_content the group also receives FAN_OPEN_PERM
+ * and FAN_ACCESS_PERM events which must be answered with a verdict.
+ */
+enum class FanotifyClass {
+    notification,
+    content,
+    pre_content
+};
+
+enum class Verdict {
+    allow,
+    deny
+};
+
+using PermissionHandler = std::function<Verdict(const FileSystemEvent&)>;
+
+struct FanotifyOptions {
+    FanotifyClass fanClass = FanotifyClass::notification;
+
+    //! report the thread id instead of the process id (FAN_REPORT_TID), excludes reportPidfd
+    bool reportTid = false;
+
+    //! let the kernel pass a pidfd with every event (FAN_REPORT_PIDFD), excludes reportTid
+    bool reportPidfd = false;
+
+    //! attach comm/exe/cgroup of the causing process to every event
+    bool processInfo = false;
+
+    //! hand the event fd to observers instead of closing it, @see Notification::getFileDescriptor
+    bool keepEventFd = false;
+
+    //! keep kernel ignore marks after the file was modified (FAN_MARK_IGNORED_SURV_MODIFY)
+    bool ignoreSurviveModify = true;
+
+    //! bytes read from the fanotify device per read(2), one event needs at least 24 bytes
+    std::size_t bufferSize = 65536;
+
+    //! lift the 16384 events queue limit (FAN_UNLIMITED_QUEUE)
+    bool unlimitedQueue = false;
+
+    //! lift the 8192 marks limit (FAN_UNLIMITED_MARKS)
+    bool unlimitedMarks = false;
+
+    //! answer of a permission event if the permission handler throws
+    Verdict fallbackVerdict = Verdict::deny;
+};
+
+class VerdictEngine;
+
 class Fanotify : public Notify {
 public:
-    Fanotify();
+    Fanotify(const FanotifyOptions& = FanotifyOptions());
     ~Fanotify();
 
+    void setPermissionHandler(PermissionHandler);
+    void setVerdictWorkers(std::size_t);
+    void setVerdictCacheSize(std::size_t);
+
     virtual void watchMountPoint(const FileSystemEvent&);
     virtual void watchFile(const FileSystemEvent&) override;
+    virtual void watchDirectory(const FileSystemEvent&) override;
     virtual void unwatch(const FileSystemEvent&) override;
+    virtual void ignore(const std::filesystem::path&) override;
     virtual TFileSystemEventPtr getNextEvent() override;
     virtual std::uint32_t getEventMask(const Event) const override;
+    virtual void placeBuffers(bool lock) override;
+    virtual void setWorkerThreadOptions(const ThreadOptions&) override;
 
 private:
     void initFanotify();
     void watch(const std::filesystem::path&, unsigned int, const Event = Event::open);
+    bool isPermissionClass() const;
+    void decodeRecord(const fanotify_event_metadata&,
+        std::uint64_t readTime,
+        bool deduplicate,
+        std::vector<fanotify_response>&);
+    void handlePermission(const fanotify_event_metadata&,
+        const std::filesystem::path&,
+        const TProcessInfoPtr&,
+        std::vector<fanotify_response>&);
+    TProcessInfoPtr getProcessInfo(const fanotify_event_metadata&);
 
     int _FanotifyFd = -1;
 
-    enum { FD_POLL_FANOTIFY = 0,
-        FD_POLL_MAX };
+    FanotifyOptions _Options;
+
+    std::unique_ptr<VerdictEngine> _VerdictEngine;
+
+    std::unique_ptr<ProcessCache> _ProcessCache;
 
-    const size_t _fanotify_buffer_size = 8192;
+    //! read buffer, allocated once and cache line aligned for the metadata
+    ReadBuffer _Buffer;
 };
 }
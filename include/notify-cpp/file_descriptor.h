@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <memory>
+
+namespace notifycpp {
+
+/**
+ * @brief Owning, move-only file descriptor handle. The descriptor is
+ *        closed when the handle is destroyed.
+ */
+class FileDescriptor {
+public:
+    FileDescriptor();
+    explicit FileDescriptor(int);
+    ~FileDescriptor();
+
+    FileDescriptor(FileDescriptor&&) noexcept;
+    FileDescriptor& operator=(FileDescriptor&&) noexcept;
+
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+    int get() const;
+
+    //! give up ownership without closing
+    int release();
+
+    void reset(int = -1);
+
+    explicit operator bool() const;
+
+private:
+    int _Fd;
+};
+using TFileDescriptorPtr = std::shared_ptr<FileDescriptor>;
+}
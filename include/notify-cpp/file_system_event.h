@@ -6,6 +6,11 @@
 #include <vector>
 
 #include <notify-cpp/event.h>
+#include <notify-cpp/file_descriptor.h>
+#include <notify-cpp/pipeline_timing.h>
+#include <notify-cpp/process_info.h>
+
+#include <sys/types.h>
 
 namespace notifycpp {
 class FileSystemEvent {
@@ -13,10 +18,28 @@ public:
     FileSystemEvent(const std::filesystem::path&);
     FileSystemEvent(const std::filesystem::path&,
         const Event);
+    FileSystemEvent(const std::filesystem::path&,
+        const Event,
+        pid_t);
     ~FileSystemEvent();
 
     Event getEvent() const;
-    std::filesystem::path getPath() const;
+    const std::filesystem::path& getPath() const;
+
+    //! pid (or tid) of the process which caused the event, 0 if unknown
+    pid_t getPid() const;
+
+    TProcessInfoPtr getProcessInfo() const;
+    void setProcessInfo(TProcessInfoPtr);
+
+    //! descriptor of the object which caused the event, nullptr if not kept
+    TFileDescriptorPtr getFileDescriptor() const;
+    void setFileDescriptor(TFileDescriptorPtr);
+
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    const PipelineTimestamps& getTimestamps() const;
+    void setTimestamps(const PipelineTimestamps&);
+#endif
 
 private:
     //!
@@ -24,6 +47,16 @@ private:
 
     //! absoulte path + filename
     std::filesystem::path _Path;
+
+    pid_t _Pid;
+
+    TProcessInfoPtr _ProcessInfo;
+
+    TFileDescriptorPtr _FileDescriptor;
+
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    PipelineTimestamps _Timestamps;
+#endif
 };
 using TFileSystemEventPtr = std::shared_ptr<FileSystemEvent>;
 }
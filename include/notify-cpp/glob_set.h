@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Many glob patterns matched in one pass over a path
+ *
+ * Pattern syntax, close to .gitignore:
+ *  - '*' and '?' match within one component, '**' across components
+ *  - '[a-z]', '[!a-z]' and '[^a-z]' match one character of a class
+ *  - '\' escapes the next character, a trailing '/' is ignored
+ *  - a pattern without '/' matches any component of the path, so
+ *    "node_modules" and "*.log" also match everything below such a
+ *    directory
+ *  - a pattern with '/' matches the path from its start or, unless it
+ *    starts with '/', from any component. A match of a parent directory
+ *    matches the path as well.
+ * Negated patterns ('!') are not supported.
+ *
+ * Literal names, "*.ext" suffixes and literal paths are looked up in
+ * hash sets. Every other pattern contributes its longest literal to an
+ * Aho-Corasick automaton. The automaton runs once over the path and only
+ * the patterns whose literal occurs are run against the path.
+ *
+ * The set is immutable after construction and may be shared by threads.
+ */
+class GlobSet {
+public:
+    GlobSet() = default;
+    GlobSet(GlobSet&&) = default;
+    GlobSet& operator=(GlobSet&&) = default;
+    //! the hash sets view into the storage of the set
+    GlobSet(const GlobSet&) = delete;
+    GlobSet& operator=(const GlobSet&) = delete;
+
+    //! @throws std::invalid_argument on a malformed pattern
+    explicit GlobSet(const std::vector<std::string>& patterns);
+
+    bool matches(std::string_view path) const;
+
+    //! number of patterns
+    std::size_t size() const;
+
+    bool empty() const;
+
+private:
+    enum class TokenType : std::uint8_t { literal, any, star, globstar, characterClass };
+
+    struct Token {
+        TokenType type;
+        char literal;
+        //! index into _Classes
+        std::uint32_t characterClass;
+    };
+
+    struct Glob {
+        std::vector<Token> tokens;
+        //! matches components instead of the path
+        bool component;
+        //! match from any component instead of the path start
+        bool floating;
+    };
+
+    struct Node {
+        //! sorted by character
+        std::vector<std::pair<char, std::uint32_t>> next;
+        std::uint32_t fail = 0;
+        //! next node on the fail chain with outputs
+        std::uint32_t output = 0;
+        //! globs whose literal ends here
+        std::vector<std::uint32_t> globs;
+        //! length of the literal ending here
+        std::uint32_t depth = 0;
+    };
+
+    void addPattern(const std::string&);
+    Glob compile(std::string_view pattern, bool component, bool floating, std::string& longestLiteral);
+    std::string_view store(std::string_view);
+    void addLiteral(const std::string&, std::uint32_t glob);
+    void buildAutomaton();
+    std::uint32_t step(std::uint32_t node, char) const;
+
+    bool matchesComponents(std::string_view path) const;
+    bool matchesPaths(std::string_view path) const;
+    bool verify(const Glob&, std::string_view path, std::size_t literalEnd) const;
+    bool verifyAnywhere(const Glob&, std::string_view path) const;
+    bool matchTokens(const std::vector<Token>&, std::size_t token, std::string_view text, std::size_t position, bool prefix) const;
+
+    std::size_t _Size = 0;
+
+    //! storage of the hashed literals, stable under push_back and move
+    std::deque<std::string> _Literals;
+    std::unordered_set<std::string_view> _Names;
+    std::unordered_set<std::string_view> _Suffixes;
+    std::unordered_set<std::string_view> _Paths;
+
+    std::vector<Glob> _Globs;
+    std::vector<std::uint32_t> _Unfiltered;
+    std::vector<std::array<bool, 256>> _Classes;
+
+    std::vector<Node> _Nodes;
+    std::array<bool, 256> _StartBytes {};
+};
+}
@@ -71,14 +71,17 @@ public:
     Inotify();
     ~Inotify();
     virtual void watchFile(const FileSystemEvent&) override;
-    virtual void watchDirectory(const FileSystemEvent&);
+    virtual void watchDirectory(const FileSystemEvent&) override;
     virtual void unwatch(const FileSystemEvent&) override;
     virtual TFileSystemEventPtr getNextEvent() override;
     virtual std::uint32_t getEventMask(const Event) const override;
+    virtual void placeBuffers(bool lock) override;
 
 private:
     std::filesystem::path wdToPath(int wd);
     void removeWatch(int wd);
+    void rememberInode(int wd, const std::filesystem::path&);
+    bool isDuplicateRecord(const inotify_event&, const std::filesystem::path&, Event);
     void init();
 
     // Member
@@ -86,8 +89,11 @@ private:
     std::vector<std::string> mIgnoredDirectories;
     std::vector<std::string> mOnceIgnoredDirectories;
     std::map<int, std::filesystem::path> mDirectorieMap;
+    //! device and inode of the watched paths
+    std::map<int, std::pair<dev_t, ino_t>> mWatchInodes;
     int mInotifyFd;
     std::atomic<bool> stopped;
     std::function<void(FileSystemEvent)> mOnEventTimeout;
+    ReadBuffer _Buffer;
 };
 }
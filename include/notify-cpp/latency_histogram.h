@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace notifycpp {
+
+/**
+ * @brief HDR-style log-linear histogram of nanosecond latencies
+ *
+ * Values are grouped by their highest set bit and every group is split
+ * linearly into 128 sub-buckets, which keeps the relative error below
+ * 1%. Recording is lock-free, every bucket is a relaxed atomic counter,
+ * so one thread may record while others query percentiles.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SubBucketBits = 7;
+    static constexpr std::size_t SubBuckets = std::size_t(1) << SubBucketBits;
+    static constexpr std::size_t Buckets = (64 - SubBucketBits + 1) * SubBuckets;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    void record(std::uint64_t);
+
+    std::uint64_t count() const;
+    std::uint64_t max() const;
+
+    //! @param percentile in [0, 100]
+    std::uint64_t percentile(double) const;
+
+    void reset();
+
+private:
+    static std::size_t index(std::uint64_t);
+    static std::uint64_t upperBound(std::size_t);
+
+    std::array<std::atomic<std::uint64_t>, Buckets> _Counts;
+    std::atomic<std::uint64_t> _Count;
+    std::atomic<std::uint64_t> _Max;
+};
+}
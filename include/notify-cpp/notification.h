@@ -1,18 +1,43 @@
 #pragma once
 
 #include <notify-cpp/event.h>
+#include <notify-cpp/file_descriptor.h>
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/process_info.h>
+
+#include <functional>
+#include <sys/types.h>
 
 namespace notifycpp {
 
 class Notification {
 public:
     Notification(Event, const std::string&);
+    Notification(Event, const FileSystemEvent&);
 
     std::string getPath() const;
     Event getEvent() const;
 
+    //! pid (or tid) of the process which caused the event, 0 if unknown
+    pid_t getPid() const;
+
+    //! comm/exe/cgroup of the process, nullptr if not requested
+    TProcessInfoPtr getProcessInfo() const;
+
+    /**
+     * Descriptor of the file which caused a fanotify event, only set if
+     * FanotifyOptions::keepEventFd is enabled. Reading through it avoids
+     * reopening the path. It is closed with the last copy of the handle.
+     */
+    TFileDescriptorPtr getFileDescriptor() const;
+
 private:
     Event _Event;
     std::string _Path;
+    pid_t _Pid;
+    TProcessInfoPtr _ProcessInfo;
+    TFileDescriptorPtr _FileDescriptor;
 };
+
+using EventObserver = std::function<void(Notification)>;
 }
@@ -25,13 +25,25 @@
 #include <notify-cpp/file_system_event.h>
 
 #include <notify-cpp/event.h>
+#include <notify-cpp/event_filter.h>
+#include <notify-cpp/glob_set.h>
+#include <notify-cpp/notify_stats.h>
+#include <notify-cpp/perf_profiler.h>
+#include <notify-cpp/pipeline_timing.h>
+#include <notify-cpp/thread_options.h>
+#include <notify-cpp/tree_index.h>
 
 #include <atomic>
+#include <chrono>
 #include <filesystem>
+#include <memory>
 #include <queue>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include <sys/types.h>
+
 /**
  * @brief Base class
  */
@@ -41,31 +53,124 @@ class Notify {
 
 public:
     Notify();
+    virtual ~Notify() = default;
 
     virtual void watchFile(const FileSystemEvent&) = 0;
+    virtual void watchDirectory(const FileSystemEvent&) = 0;
     virtual void unwatch(const FileSystemEvent&) = 0;
 
     virtual TFileSystemEventPtr getNextEvent() = 0;
 
-    void stop();
+    virtual void stop();
     bool hasStopped();
 
     virtual std::uint32_t getEventMask(const Event) const = 0;
-    void ignore(const std::filesystem::path&);
+    virtual void ignore(const std::filesystem::path&);
     void ignoreOnce(const std::filesystem::path&);
 
+    /**
+     * Ignore all paths matching one of the patterns, see GlobSet. The
+     * crawl skips matching directories, their events are dropped after
+     * decoding. Set the patterns before watching.
+     */
+    void setIgnorePatterns(std::shared_ptr<const GlobSet>);
+
     void watchPathRecursively(const FileSystemEvent&);
 
+    /**
+     * Keep index up to date, attach it before watchPathRecursively. The
+     * crawled directories are also watched for create, delete and move
+     * events, which reach the observers as well.
+     */
+    void setTreeIndex(std::shared_ptr<TreeIndex>);
+    std::shared_ptr<TreeIndex> getTreeIndex() const;
+
+    /**
+     * Watch the directories of an index loaded from a snapshot instead of
+     * crawling and queue create, modify and delete_sub events for all
+     * changes since the snapshot. The directories are compared in parallel.
+     *
+     * @param threads 0 uses one thread per CPU
+     */
+    void watchTreeIndex(Event, std::size_t threads = 0);
+
+    /**
+     * Drop the events the filter rejects right after decoding, they are
+     * counted as ignored. The tree index still sees them. Set the filter
+     * before the event loop runs.
+     */
+    void setFilter(TEventFilterPtr);
+    TEventFilterPtr getFilter() const;
+
+    /**
+     * Allocate the read buffer again on the calling thread, so it is local
+     * to its NUMA node, and optionally lock it into memory. Called from the
+     * reader thread after it has been pinned.
+     *
+     * @throws std::runtime_error if the buffer can't be locked
+     */
+    virtual void placeBuffers(bool lock);
+
+    /**
+     * Collapse events of the same inode and event read in one batch, e.g.
+     * of a file watched directly and through its directory, a bind mount
+     * or a hardlink. The first path wins. Costs an lstat(2) per entry
+     * event of a batch with more than one record.
+     */
+    void setDeduplication(bool);
+
+    /**
+     * Busy-poll the kernel descriptor for up to budget before blocking in
+     * poll(2), with a pause backoff between the reads. Trades a core for
+     * wake-up latency, 0 always blocks. Used by inotify and fanotify.
+     */
+    void setSpinBudget(std::chrono::nanoseconds budget);
+    std::chrono::nanoseconds getSpinBudget() const;
+
+    //! applied to the threads the backend starts, e.g. verdict workers
+    virtual void setWorkerThreadOptions(const ThreadOptions&);
+    const ThreadOptions& getWorkerThreadOptions() const;
+
+    NotifyStats getStats() const;
+    void countObserverInvocations(std::uint64_t);
+
+    /**
+     * Sample the hardware counters around decoding, from the return of a
+     * read until the next event is dequeued. The wait for the kernel is
+     * not included. nullptr stops sampling.
+     */
+    void setProfiler(std::shared_ptr<PerfProfiler>);
+
+    //! per stage latencies, nullptr unless built with ENABLE_PIPELINE_TIMING
+    const PipelineTiming* getPipelineTiming() const;
+
+    //! record the timestamps of an event whose observers returned
+    void recordPipelineTiming(const FileSystemEvent&, std::uint64_t dispatched);
+
 protected:
+    void enqueue(TFileSystemEventPtr, std::uint64_t readTime);
+    TFileSystemEventPtr dequeue();
+
     bool checkWatchFile(const FileSystemEvent&) const;
     bool checkWatchDirectory(const FileSystemEvent&) const;
     bool isIgnored(const std::filesystem::path&) const;
     bool isIgnoredOnce(const std::filesystem::path&) const;
+    bool isFiltered(const std::filesystem::path&, Event);
     std::string getFilePath(int) const;
     bool isStopped() const;
     bool isRunning() const;
+    void indexDirectory(const std::filesystem::path&);
+    ssize_t readEvents(int fd, char* buffer, std::size_t size);
+    void beginDecodeSample();
+    void endDecodeSample();
+
+    //! forget the inodes of the previous read batch
+    void beginBatch();
+    //! true if the inode already had this event in the batch, counted as deduplicated
+    bool isDuplicate(dev_t, ino_t, Event);
 
     std::vector<std::filesystem::path> _Ignored;
+    std::shared_ptr<const GlobSet> _IgnorePatterns;
     mutable std::vector<std::filesystem::path> _IgnoredOnce;
 
     std::queue<TFileSystemEventPtr> _Queue;
@@ -74,6 +179,61 @@ protected:
 
     const uint32_t mThreadSleep;
 
+    std::chrono::nanoseconds _SpinBudget { 0 };
+
+    bool _Deduplicate = false;
+
     EventHandler _EventHandler;
+
+    NotifyCounters _Counters;
+
+    std::shared_ptr<TreeIndex> _TreeIndex;
+
+    std::shared_ptr<PerfProfiler> _Profiler;
+    //! counters after the last read, valid while _Decoding
+    HardwareCounters _DecodeStart;
+    bool _Decoding = false;
+
+    TEventFilterPtr _Filter;
+
+    ThreadOptions _WorkerThreadOptions;
+
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    std::unique_ptr<PipelineTiming> _PipelineTiming;
+#endif
+
+private:
+    struct BatchKey {
+        dev_t dev;
+        ino_t ino;
+        Event event;
+
+        bool operator==(const BatchKey& other) const
+        {
+            return dev == other.dev && ino == other.ino && event == other.event;
+        }
+    };
+
+    struct BatchKeyHash {
+        std::size_t operator()(const BatchKey& key) const
+        {
+            return std::hash<std::uint64_t>()((static_cast<std::uint64_t>(key.ino) * 0x9e3779b97f4a7c15ULL)
+                ^ (static_cast<std::uint64_t>(key.dev) << 32) ^ static_cast<std::uint64_t>(key.event));
+        }
+    };
+
+    //! inodes and events queued from the current read batch
+    std::unordered_set<BatchKey, BatchKeyHash> _BatchKeys;
 };
+
+#ifndef NOTIFYCPP_PIPELINE_TIMING
+inline const PipelineTiming* Notify::getPipelineTiming() const
+{
+    return nullptr;
+}
+
+inline void Notify::recordPipelineTiming(const FileSystemEvent&, std::uint64_t)
+{
+}
+#endif
 }
@@ -1,21 +1,39 @@
 #pragma once
 
+#include <notify-cpp/event_journal.h>
+#include <notify-cpp/event_publisher.h>
+#include <notify-cpp/fake_notify.h>
+#include <notify-cpp/fanotify.h>
 #include <notify-cpp/notification.h>
 #include <notify-cpp/notify.h>
+#include <notify-cpp/path_router.h>
+#include <notify-cpp/perf_profiler.h>
+#include <notify-cpp/replay_notify.h>
+#include <notify-cpp/thread_options.h>
 
+#include <chrono>
 #include <filesystem>
 #include <functional>
-#include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace notifycpp {
 
-using EventObserver = std::function<void(Notification)>;
+struct ControllerThreadOptions {
+    //! the thread which calls runOnce first, a failure is thrown from there
+    ThreadOptions reader;
+    //! verdict workers, snapshot diff threads and subscribers, best effort
+    ThreadOptions workers;
+    //! lock the read buffer of the backend into memory with mlock(2)
+    bool lockBuffers = false;
+};
 
 class NotifyController {
 public:
+    //! takes ownership of the backend
     NotifyController(Notify*);
     NotifyController() = default;
 
@@ -37,33 +55,159 @@ public:
 
     NotifyController& ignoreOnce(const std::filesystem::path&);
 
+    //! ignore paths matching any of the glob patterns, see GlobSet
+    NotifyController& ignorePatterns(const std::vector<std::string>&);
+
     NotifyController& onEvent(Event event, EventObserver);
 
     NotifyController& onEvents(std::set<Event> event, EventObserver);
 
+    /**
+     * Observe the events below a path prefix. All prefixes of a path are
+     * found in one walk along its components, however many are registered.
+     * The prefix must be absolute, std::invalid_argument is thrown otherwise.
+     */
+    NotifyController& onPath(const std::filesystem::path& prefix, Event, EventObserver);
+
+    //! called if neither onEvent nor onPath observers take an event
     NotifyController& onUnexpectedEvent(EventObserver);
 
+    /**
+     * Collapse the events of one inode read in the same batch, e.g. of a
+     * file watched directly and through its directory. @see Notify::setDeduplication
+     */
+    NotifyController& deduplicate(bool = true);
+
+    //! drop events rejected by a filter expression before they are dispatched, see EventFilter
+    NotifyController& setFilter(const std::string& expression);
+
+    /**
+     * Call observer on a thread of its own for every matching event. The
+     * events reach the subscribers before the observers of onEvent.
+     * The first subscription has to be made before run().
+     */
+    TSubscriberPtr subscribe(const SubscriberOptions&, EventObserver);
+
+    NotifyController& unsubscribe(const TSubscriberPtr&);
+
+    //! keep index up to date, attach it before watchPathRecursively
+    NotifyController& setTreeIndex(std::shared_ptr<TreeIndex>);
+    std::shared_ptr<TreeIndex> getTreeIndex() const;
+
+    /**
+     * Load a snapshot into the tree index, watch its directories and
+     * queue events for the changes made since it was saved.
+     */
+    NotifyController& restoreSnapshot(const std::filesystem::path&, Event, std::size_t threads = 0);
+
+    NotifyController& saveSnapshot(const std::filesystem::path&);
+
+    //! let run() save a snapshot every interval and when it returns
+    NotifyController& setSnapshotInterval(const std::filesystem::path&, std::chrono::seconds);
+
+    //! append every event to the journal before it is dispatched
+    NotifyController& setJournal(std::shared_ptr<EventJournal>);
+
+    std::uint64_t replay(const EventJournal&, std::uint64_t from = 1);
+
+    NotifyStats getStats() const;
+
+    /**
+     * Sample hardware counters of the thread which calls runOnce first,
+     * around decoding a read batch (see Notify::setProfiler) and around
+     * the observers of every event. Reported by getStats() if
+     * perf_event_open(2) is permitted, otherwise silently disabled.
+     */
+    NotifyController& enableProfiling();
+
+    //! per stage latencies, nullptr unless built with ENABLE_PIPELINE_TIMING
+    const PipelineTiming* getPipelineTiming() const;
+
+    /**
+     * Pin the reader and worker threads and set their scheduling policy.
+     * The reader applies its options on the next runOnce and then
+     * allocates the read buffer again, so it is local to its NUMA node.
+     * Set the options before subscribing and starting verdict workers.
+     */
+    NotifyController& setThreadOptions(const ControllerThreadOptions&);
+
+    /**
+     * Busy-poll the inotify or fanotify descriptor this long before
+     * blocking. Lowers the wake-up latency for a core, best combined with
+     * a reader pinned by setThreadOptions. getStats() reports the spin
+     * hits and the time spent spinning.
+     */
+    NotifyController& setSpinBudget(std::chrono::nanoseconds);
+
 protected:
-    Notify* _Notify;
-    //std::unique_ptr<Notify> _Notify;
+    //! shared by all copies of the controller
+    std::shared_ptr<Notify> _Notify;
 
 private:
-    std::vector<std::pair<Event, EventObserver>> findObserver(Event e) const;
+    void addObserver(Event, EventObserver);
+    void dispatch(const FileSystemEvent&);
+    void compileObservers();
+
+    //! registered observers ordered by Event
+    std::vector<std::pair<Event, EventObserver>> mEventObserver;
+
+    /**
+     * Dispatch table: the observers matching an event mask e are
+     * mEventObserver[mDispatchIndex[i]] for i in
+     * [mDispatchOffset[e], mDispatchOffset[e + 1]).
+     */
+    std::vector<std::uint32_t> mDispatchOffset;
+    std::vector<std::uint32_t> mDispatchIndex;
+    bool mDispatchDirty = true;
 
-    std::map<Event, EventObserver> mEventObserver;
+    PathRouter mPathRouter;
 
     EventObserver mUnexpectedEventObserver;
+
+    std::shared_ptr<PerfProfiler> mProfiler;
+
+    ControllerThreadOptions mThreadOptions;
+    bool mPlaceReader = false;
+
+    std::shared_ptr<EventJournal> mJournal;
+
+    std::shared_ptr<EventPublisher> mPublisher;
+
+    std::filesystem::path mSnapshotPath;
+    std::chrono::seconds mSnapshotInterval { 0 };
 };
 
 class FanotifyController : public NotifyController {
 public:
     FanotifyController();
+    FanotifyController(const FanotifyOptions&);
 
-    NotifyController& watchMountPoint(const std::filesystem::path&);
+    NotifyController& watchMountPoint(const FileSystemEvent&);
+
+    NotifyController& onPermission(PermissionHandler);
+
+    NotifyController& setVerdictWorkers(std::size_t);
+
+    //! see Fanotify::setVerdictCacheSize, off by default
+    NotifyController& setVerdictCacheSize(std::size_t);
 };
 
 class InotifyController : public NotifyController {
 public:
     InotifyController();
 };
+
+class FakeNotifyController : public NotifyController {
+public:
+    FakeNotifyController();
+
+    //! inject events, advance the virtual clock and simulate overflows
+    FakeNotify& getFakeNotify();
+};
+
+//! plays back a journal recorded by setJournal() through the observers
+class ReplayNotifyController : public NotifyController {
+public:
+    ReplayNotifyController(const EventJournal&, const ReplayOptions& = ReplayOptions());
+};
 }
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+
+namespace notifycpp {
+
+/**
+ * @brief Hardware counters of the thread running a NotifyController,
+ *        @see NotifyController::enableProfiling()
+ */
+struct HardwareCounters {
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cacheMisses = 0;
+
+    HardwareCounters perEvent(std::uint64_t events) const
+    {
+        if (events == 0)
+            return {};
+        return { cycles / events, instructions / events, cacheMisses / events };
+    }
+};
+
+/**
+ * @brief Snapshot of the runtime counters of a Notify backend
+ */
+struct NotifyStats {
+    //! read() and poll() calls of the event loop
+    std::uint64_t syscalls = 0;
+    std::uint64_t bytesRead = 0;
+    //! kernel event records, before they are split into single events
+    std::uint64_t eventsDecoded = 0;
+    //! records dropped by ignoreOnce() or because their watch is unknown
+    std::uint64_t eventsIgnored = 0;
+    //! events dropped as duplicates of the same inode in one read batch
+    std::uint64_t eventsDeduplicated = 0;
+    std::uint64_t queueHighWatermark = 0;
+    //! IN_Q_OVERFLOW / FAN_Q_OVERFLOW records, events were lost
+    std::uint64_t overflows = 0;
+    std::uint64_t observerInvocations = 0;
+    std::uint64_t activeWatches = 0;
+    //! paths visited by watchPathRecursively()
+    std::uint64_t crawledPaths = 0;
+    //! permission handlers which threw and verdicts which couldn't be written
+    std::uint64_t permissionErrors = 0;
+    //! reads while busy-polling, @see Notify::setSpinBudget()
+    std::uint64_t spinReads = 0;
+    //! busy-polls which found events before the budget ran out
+    std::uint64_t spinHits = 0;
+    //! time spent busy-polling, the CPU cost of the spin budget
+    std::uint64_t spinNanoseconds = 0;
+    //! poll(2) calls blocking the event loop
+    std::uint64_t blockingWaits = 0;
+
+    //! true if hardware counters are sampled, the fields below are 0 otherwise
+    bool profiling = false;
+    std::uint64_t profiledEvents = 0;
+    //! spent decoding read batches, without waiting for and reading from the kernel
+    HardwareCounters decodeCounters;
+    //! spent in the observers
+    HardwareCounters dispatchCounters;
+};
+
+/**
+ * @brief The live counters behind NotifyStats
+ *
+ * All counters are relaxed atomics. They are written by the thread
+ * running the event loop and may be read from any thread, a snapshot
+ * is not consistent across counters.
+ */
+struct NotifyCounters {
+    std::atomic<std::uint64_t> syscalls { 0 };
+    std::atomic<std::uint64_t> bytesRead { 0 };
+    std::atomic<std::uint64_t> eventsDecoded { 0 };
+    std::atomic<std::uint64_t> eventsIgnored { 0 };
+    std::atomic<std::uint64_t> eventsDeduplicated { 0 };
+    std::atomic<std::uint64_t> queueHighWatermark { 0 };
+    std::atomic<std::uint64_t> overflows { 0 };
+    std::atomic<std::uint64_t> observerInvocations { 0 };
+    std::atomic<std::uint64_t> activeWatches { 0 };
+    std::atomic<std::uint64_t> crawledPaths { 0 };
+    std::atomic<std::uint64_t> permissionErrors { 0 };
+    std::atomic<std::uint64_t> spinReads { 0 };
+    std::atomic<std::uint64_t> spinHits { 0 };
+    std::atomic<std::uint64_t> spinNanoseconds { 0 };
+    std::atomic<std::uint64_t> blockingWaits { 0 };
+
+    static void add(std::atomic<std::uint64_t>& counter, std::uint64_t value = 1)
+    {
+        counter.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    static void set(std::atomic<std::uint64_t>& gauge, std::uint64_t value)
+    {
+        gauge.store(value, std::memory_order_relaxed);
+    }
+
+    //! raise gauge to value if it is lower
+    static void raise(std::atomic<std::uint64_t>& gauge, std::uint64_t value)
+    {
+        if (gauge.load(std::memory_order_relaxed) < value)
+            gauge.store(value, std::memory_order_relaxed);
+    }
+
+    NotifyStats snapshot() const;
+};
+
+/**
+ * @brief Write the stats in the Prometheus text exposition format
+ */
+void writePrometheus(std::ostream&, const NotifyStats&);
+
+//! write to an open file descriptor, e.g. a pipe or socket
+void writePrometheus(int fd, const NotifyStats&);
+
+/**
+ * @brief Replace the file atomically, as expected by the textfile
+ *        collector of the node exporter
+ */
+void writePrometheus(const std::filesystem::path&, const NotifyStats&);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <notify-cpp/event.h>
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/notification.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace notifycpp {
+
+/**
+ * @brief Routes events to observers registered for path prefixes
+ *
+ * The prefixes form a trie of path components. An event walks from the
+ * root along the components of its path and calls the matching routes
+ * of every node it passes, so the cost depends on the depth of the path
+ * and not on the number of routes. Prefixes match whole components,
+ * "/src" matches "/src/a" but not "/srcx". Prefixes are absolute, events
+ * with a relative path are not routed.
+ */
+class PathRouter {
+public:
+    PathRouter();
+
+    /**
+     * @brief Observers of the same prefix are called in registration order
+     * @throws std::invalid_argument if the prefix is relative
+     */
+    void add(const std::filesystem::path& prefix, Event, EventObserver);
+
+    /**
+     * @brief Call the observers of all prefixes of the path which
+     *        take the event
+     * @return number of called observers
+     */
+    std::size_t dispatch(const FileSystemEvent&) const;
+
+    bool empty() const;
+
+private:
+    struct Node {
+        //! sorted by component
+        std::vector<std::pair<std::string, std::uint32_t>> children;
+        //! indices into _Routes
+        std::vector<std::uint32_t> routes;
+    };
+
+    std::uint32_t findChild(std::uint32_t node, std::string_view component) const;
+
+    std::vector<Node> _Nodes;
+    std::vector<std::pair<Event, EventObserver>> _Routes;
+};
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <notify-cpp/notify_stats.h>
+
+#include <atomic>
+#include <cstdint>
+
+#include <sys/types.h>
+
+namespace notifycpp {
+
+/**
+ * @brief Hardware counters of one thread via perf_event_open(2)
+ *
+ * Cycles, instructions and cache misses are opened as one group on the
+ * first call of open() and only count while that thread runs. Counts of
+ * a group the kernel had to multiplex are scaled to the time it was
+ * enabled. If the
+ * kernel refuses to count kernel mode, as with perf_event_paranoid 2
+ * for unprivileged users, only user mode is counted. Without permission
+ * or without a PMU, e.g. in many virtual machines, the profiler stays
+ * closed and all samples are skipped.
+ */
+class PerfProfiler {
+public:
+    PerfProfiler() = default;
+    ~PerfProfiler();
+
+    PerfProfiler(const PerfProfiler&) = delete;
+    PerfProfiler& operator=(const PerfProfiler&) = delete;
+
+    //! open the counters for the calling thread, false if unavailable or opened by another thread
+    bool open();
+
+    bool sample(HardwareCounters&) const;
+
+    //! add the counters of decoding a read batch
+    void recordDecode(const HardwareCounters& start, const HardwareCounters& done);
+
+    //! add the counters of dispatching one event
+    void recordDispatch(const HardwareCounters& start, const HardwareCounters& done);
+
+    //! fill the profiling fields of stats
+    void addTo(NotifyStats&) const;
+
+private:
+    int openCounter(std::uint64_t config, int groupFd, bool excludeKernel) const;
+    bool openGroup(bool excludeKernel);
+    void close();
+
+    int _Fds[3] = { -1, -1, -1 };
+    pid_t _Tid = 0;
+    bool _Failed = false;
+
+    std::atomic<bool> _Open { false };
+    std::atomic<std::uint64_t> _Events { 0 };
+    std::atomic<std::uint64_t> _DecodeCounters[3] = { { 0 }, { 0 }, { 0 } };
+    std::atomic<std::uint64_t> _DispatchCounters[3] = { { 0 }, { 0 }, { 0 } };
+};
+}
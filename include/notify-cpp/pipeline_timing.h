@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <notify-cpp/config.h>
+#include <notify-cpp/latency_histogram.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+
+namespace notifycpp {
+
+/**
+ * Stages an event passes between read() and the return of its last
+ * observer. The time an event spent in the kernel queue is not
+ * measurable, neither inotify nor fanotify report when it was queued.
+ */
+enum class PipelineStage {
+    //! read() returned -> FileSystemEvent decoded
+    decode = 0,
+    //! FileSystemEvent queued -> taken by the controller
+    queue,
+    //! taken by the controller -> last observer returned
+    observer,
+    //! read() returned -> last observer returned
+    total
+};
+
+constexpr std::size_t PipelineStageCount = 4;
+
+struct PipelineTimestamps {
+    std::uint64_t read = 0;
+    std::uint64_t decoded = 0;
+    std::uint64_t enqueued = 0;
+    std::uint64_t dispatched = 0;
+};
+
+/**
+ * @brief Monotonic clock in nanoseconds, always 0 if the library was
+ *        built without ENABLE_PIPELINE_TIMING
+ */
+inline std::uint64_t pipelineClock()
+{
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief One latency histogram per PipelineStage
+ */
+class PipelineTiming {
+public:
+    void record(const PipelineTimestamps&, std::uint64_t done);
+
+    const LatencyHistogram& getHistogram(PipelineStage) const;
+
+    void reset();
+
+private:
+    std::array<LatencyHistogram, PipelineStageCount> _Histograms;
+};
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace notifycpp {
+
+struct ProcessInfo {
+    pid_t pid = 0;
+    //! /proc/<pid>/comm
+    std::string comm;
+    //! /proc/<pid>/exe
+    std::filesystem::path exe;
+    //! unified (v2) hierarchy entry of /proc/<pid>/cgroup
+    std::string cgroup;
+};
+using TProcessInfoPtr = std::shared_ptr<const ProcessInfo>;
+
+/**
+ * @brief pid -> ProcessInfo cache
+ *
+ * /proc is only read the first time a pid is seen. Every entry keeps a
+ * pidfd of its process, sweep() polls all of them at once and drops the
+ * entries of exited processes, so a recycled pid is never attributed to
+ * the process which used it before.
+ */
+class ProcessCache {
+public:
+    ProcessCache(std::size_t maxEntries = 1024);
+    ~ProcessCache();
+
+    ProcessCache(const ProcessCache&) = delete;
+    ProcessCache& operator=(const ProcessCache&) = delete;
+
+    /**
+     * @param pidfd of the process if the kernel reported one. The cache
+     *        takes ownership, pass -1 to let the cache open one itself.
+     */
+    TProcessInfoPtr lookup(pid_t pid, int pidfd = -1);
+
+    void sweep();
+
+    std::size_t size() const;
+
+private:
+    struct Entry {
+        TProcessInfoPtr info;
+        int pidfd;
+    };
+
+    void clear();
+
+    std::unordered_map<pid_t, Entry> _Entries;
+    const std::size_t _MaxEntries;
+};
+
+TProcessInfoPtr readProcessInfo(pid_t);
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <notify-cpp/event_journal.h>
+#include <notify-cpp/file_system_event.h>
+#include <notify-cpp/notify.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace notifycpp {
+
+struct ReplayOptions {
+    //! first sequence of the journal to replay
+    std::uint64_t from = 1;
+    //! 1 replays at the recorded speed, 2 twice as fast, 0 as fast as possible
+    double speed = 1;
+    //! records moved to the queue per getNextEvent(), like one read() of the kernel queue
+    std::size_t batchSize = 256;
+};
+
+/**
+ * @brief Backend which plays back an EventJournal recorded from a live
+ *        NotifyController
+ *
+ * The records are loaded up front, so the replay does no I/O. With a
+ * speed > 0 the recorded gaps between the events are kept, scaled by the
+ * speed, otherwise getNextEvent() never waits. Watches are not needed,
+ * every recorded event is delivered except ignored paths. The backend
+ * stops itself after the last record, so NotifyController::run() returns.
+ */
+class ReplayNotify : public Notify {
+public:
+    ReplayNotify(const EventJournal&, const ReplayOptions& = ReplayOptions());
+
+    virtual void watchFile(const FileSystemEvent&) override;
+    virtual void watchDirectory(const FileSystemEvent&) override;
+    virtual void unwatch(const FileSystemEvent&) override;
+    virtual TFileSystemEventPtr getNextEvent() override;
+    virtual std::uint32_t getEventMask(const Event) const override;
+    virtual void stop() override;
+
+    //! number of loaded records
+    std::size_t size() const;
+
+    //! records not yet moved to the queue
+    std::size_t remaining() const;
+
+private:
+    struct Recorded {
+        //! time since the first record, never decreasing
+        std::chrono::nanoseconds offset;
+        FileSystemEvent event;
+    };
+
+    std::chrono::steady_clock::time_point getDue(const Recorded&) const;
+
+    ReplayOptions _Options;
+    std::vector<Recorded> _Records;
+    std::size_t _Next;
+
+    std::chrono::steady_clock::time_point _Start;
+    bool _Started;
+
+    std::mutex _Mutex;
+    std::condition_variable _Wakeup;
+};
+}
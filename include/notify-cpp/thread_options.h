@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace notifycpp {
+
+enum class SchedulingPolicy {
+    //! keep the policy of the creating thread
+    inherit,
+    //! SCHED_OTHER
+    other,
+    //! SCHED_BATCH, for throughput oriented workers
+    batch,
+    //! SCHED_IDLE
+    idle,
+    //! SCHED_FIFO, needs CAP_SYS_NICE or RLIMIT_RTPRIO
+    fifo,
+    //! SCHED_RR, needs CAP_SYS_NICE or RLIMIT_RTPRIO
+    roundRobin
+};
+
+struct ThreadOptions {
+    //! CPUs the thread may run on, empty keeps the inherited affinity
+    std::vector<unsigned int> cpus;
+    SchedulingPolicy policy = SchedulingPolicy::inherit;
+    //! static priority of fifo and roundRobin, 1 to 99
+    int priority = 1;
+};
+
+/**
+ * @brief Pin the calling thread and set its scheduling policy
+ * @throws std::runtime_error if the kernel refuses
+ */
+void applyThreadOptions(const ThreadOptions&);
+
+//! like applyThreadOptions() for threads which can't report an error, false if refused
+bool tryApplyThreadOptions(const ThreadOptions&) noexcept;
+
+/**
+ * @brief Page aligned read buffer of a backend
+ *
+ * The buffer is mapped by the constructing thread. place() maps fresh
+ * anonymous pages on the calling thread and writes every page, so with
+ * the default first touch policy the memory comes from the NUMA node the
+ * thread runs on. It can be locked into memory with mlock(2) as well.
+ */
+class ReadBuffer {
+public:
+    explicit ReadBuffer(std::size_t size);
+    ~ReadBuffer();
+
+    ReadBuffer(const ReadBuffer&) = delete;
+    ReadBuffer& operator=(const ReadBuffer&) = delete;
+
+    //! @throws std::runtime_error if mmap(2) fails or lock is requested and mlock(2) fails
+    void place(bool lock);
+
+    char* data();
+    std::size_t size() const;
+    bool isLocked() const;
+
+private:
+    void release();
+
+    char* _Data;
+    std::size_t _Size;
+    bool _Locked;
+};
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#pragma once
+
+#include <notify-cpp/file_system_event.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace notifycpp {
+
+struct TreeEntry {
+    std::string name;
+    ino_t inode = 0;
+    std::uintmax_t size = 0;
+    //! nanoseconds since the epoch
+    std::int64_t mtime = 0;
+    bool directory = false;
+};
+
+/**
+ * @brief In-memory index of a watched tree
+ *
+ * Filled by the crawl of Notify::watchPathRecursively and kept up to
+ * date from the events afterwards, so consumers can ask for the entries
+ * of a directory without readdir() and stat(). Paths are indexed as
+ * given to the backend, a relative watch yields relative paths.
+ *
+ * All nodes live in one vector, the children of a directory in one
+ * contiguous array and names are interned while a node uses them. A path is resolved with one
+ * hash lookup per component, independent of the size of a directory.
+ * Queries may run concurrently with updates.
+ */
+class TreeIndex {
+public:
+    TreeIndex();
+
+    //! index path and, for a directory, everything below it
+    void crawl(const std::filesystem::path&);
+
+    //! re-stat path, it is removed from the index if it does not exist anymore
+    void update(const std::filesystem::path&);
+
+    //! remove path and everything below it
+    void remove(const std::filesystem::path&);
+
+    /**
+     * @brief Apply an event to the index
+     * @return true if the event created a directory
+     */
+    bool apply(const FileSystemEvent&);
+
+    std::optional<TreeEntry> lookup(const std::filesystem::path&) const;
+
+    //! entries of a directory in no particular order, empty if unknown
+    std::vector<TreeEntry> list(const std::filesystem::path&) const;
+
+    //! number of indexed paths
+    std::size_t size() const;
+
+    //! all indexed directories
+    std::vector<std::filesystem::path> getDirectories() const;
+
+    /**
+     * @brief Compare an indexed directory with the filesystem
+     *
+     * @return create, modify and delete_sub events for the entries which
+     *         changed, new directories are reported with their contents
+     */
+    std::vector<FileSystemEvent> diffDirectory(const std::filesystem::path&) const;
+
+    //! write a snapshot, the file is replaced atomically
+    void save(const std::filesystem::path&) const;
+
+    //! replace the index with a snapshot written by save()
+    void load(const std::filesystem::path&);
+
+private:
+    static constexpr std::uint32_t Invalid = UINT32_MAX;
+
+    struct Node {
+        std::uint32_t parent;
+        std::uint32_t name;
+        //! position in the children of the parent
+        std::uint32_t slot;
+        bool directory;
+        bool known;
+        ino_t inode;
+        std::uintmax_t size;
+        std::int64_t mtime;
+        std::vector<std::uint32_t> children;
+    };
+
+    std::uint32_t find(const std::filesystem::path&) const;
+    std::uint32_t findOrCreate(const std::filesystem::path&);
+    std::uint32_t findName(const std::string&) const;
+    std::uint32_t internName(const std::string&);
+    void releaseName(std::uint32_t);
+    std::uint32_t createNode(std::uint32_t parent, std::uint32_t name);
+    void updateLocked(const std::filesystem::path&);
+    void removeNode(std::uint32_t);
+    TreeEntry toEntry(std::uint32_t) const;
+    std::filesystem::path getPath(std::uint32_t) const;
+
+    static std::uint64_t edge(std::uint32_t parent, std::uint32_t name)
+    {
+        return (static_cast<std::uint64_t>(parent) << 32) | name;
+    }
+
+    std::vector<Node> _Nodes;
+    std::vector<std::uint32_t> _FreeNodes;
+    std::unordered_map<std::uint64_t, std::uint32_t> _Edges;
+
+    std::deque<std::string> _Names;
+    std::unordered_map<std::string_view, std::uint32_t> _NameIds;
+    //! number of nodes using a name, a name is released with its last node
+    std::vector<std::uint32_t> _NameRefs;
+    std::vector<std::uint32_t> _FreeNames;
+
+    std::size_t _Size;
+
+    mutable std::shared_mutex _Mutex;
+};
+}
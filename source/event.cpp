@@ -35,93 +35,25 @@ namespace notifycpp {
 std::uint32_t
 EventHandler::convertToInotifyEvents(const Event event) const
 {
-    return convert(event, std::bind(&EventHandler::getInotifyEvent, this, std::placeholders::_1));
+    return toInotifyMask(event);
 }
 
 std::uint32_t
 EventHandler::convertToFanotifyEvents(const Event event) const
 {
-    return convert(event, std::bind(&EventHandler::getFanotifyEvent, this, std::placeholders::_1));
+    return toFanotifyMask(event);
 }
 
 std::uint32_t
 EventHandler::getInotifyEvent(const Event e) const
 {
-    switch (e) {
-    case Event::access:
-        return IN_ACCESS;
-    case Event::modify:
-        return IN_MODIFY;
-    case Event::attrib:
-        return IN_ATTRIB;
-    case Event::close_write:
-        return IN_CLOSE_WRITE;
-    case Event::close_nowrite:
-        return IN_CLOSE_NOWRITE;
-    case Event::open:
-        return IN_OPEN;
-    case Event::moved_from:
-        return IN_MOVED_FROM;
-    case Event::moved_to:
-        return IN_MOVED_TO;
-    case Event::create:
-        return IN_CREATE;
-    case Event::delete_sub:
-        return IN_DELETE;
-    case Event::delete_self:
-        return IN_DELETE_SELF;
-    case Event::move_self:
-        return IN_MOVE_SELF;
-    case Event::close:
-        return IN_CLOSE;
-    case Event::move:
-        return IN_MOVE;
-    case Event::all:
-        return IN_ALL_EVENTS;
-    case Event::none:
-        return 0;
-    }
-    return 0;
+    return toInotifyMask(e);
 }
 
 std::uint32_t
 EventHandler::getFanotifyEvent(const Event e) const
 {
-    switch (e) {
-    case Event::access:
-        return FAN_ACCESS;
-    case Event::modify:
-        return FAN_MODIFY;
-    case Event::attrib:
-        assert(!"None existing event");
-        return 0;
-    case Event::close_write:
-        return FAN_CLOSE_WRITE;
-    case Event::close_nowrite:
-        return FAN_CLOSE_NOWRITE;
-    case Event::open:
-        return FAN_OPEN;
-
-    case Event::moved_from:
-    case Event::moved_to:
-    case Event::create:
-    case Event::delete_sub:
-    case Event::delete_self:
-    case Event::move_self:
-        assert(!"None existing event");
-        return 0;
-
-    case Event::close:
-        return FAN_CLOSE;
-
-    case Event::move:
-    case Event::all:
-    case Event::none:
-        assert(!"None existing event");
-        return 0;
-    }
-    assert(!"None existing event");
-    return 0;
+    return toFanotifyMask(e);
 }
 
 std::string
@@ -188,39 +120,7 @@ std::ostream& operator<<(std::ostream& stream, const Event& event)
 
 Event EventHandler::getInotify(std::uint32_t e) const
 {
-    switch (e) {
-    case IN_ACCESS:
-        return Event::access;
-    case IN_MODIFY:
-        return Event::modify;
-    case IN_ATTRIB:
-        return Event::attrib;
-    case IN_CLOSE_WRITE:
-        return Event::close_write;
-    case IN_CLOSE_NOWRITE:
-        return Event::close_nowrite;
-    case IN_OPEN:
-        return Event::open;
-    case IN_MOVED_FROM:
-        return Event::moved_from;
-    case IN_MOVED_TO:
-        return Event::moved_to;
-    case IN_CREATE:
-        return Event::create;
-    case IN_DELETE:
-        return Event::delete_sub;
-    case IN_DELETE_SELF:
-        return Event::delete_self;
-    case IN_MOVE_SELF:
-        return Event::move_self;
-    case IN_CLOSE:
-        return Event::close;
-    case IN_MOVE:
-        return Event::move;
-    case IN_ALL_EVENTS:
-        return Event::all;
-    }
-    return Event::none;
+    return fromInotifyMask(e);
 }
 
 std::string EventHandler::getFanotifyStr(std::uint32_t e) const
@@ -267,53 +167,23 @@ std::string EventHandler::getFanotifyStr(std::uint32_t e) const
     return events;
 }
 
+/**
+ * @return every single event of a combined fanotify mask
+ */
 std::vector<Event> EventHandler::getFanotifyEvents(std::uint32_t e) const
 {
     std::vector<Event> events;
-    for (auto const event : AllFanFlags) {
-        std::uint32_t ie = static_cast<std::uint32_t>(event);
-        if ((e & ie) == ie) {
-            events.push_back(getFanotify(ie));
-        }
-    }
+    const Event decoded = fromFanotifyMask(e);
+    if (decoded == Event::none)
+        return events;
+
+    for (auto bits = static_cast<std::uint32_t>(decoded); bits != 0; bits &= bits - 1)
+        events.push_back(static_cast<Event>(bits & (~bits + 1)));
     return events;
 }
 
 Event EventHandler::getFanotify(std::uint32_t e) const
 {
-    switch (e) {
-        case FAN_ACCESS:
-         return Event::access;
-        case FAN_MODIFY:
-         return Event::modify;
-        case FAN_CLOSE_WRITE:
-         return Event::close_write;
-        case FAN_CLOSE_NOWRITE:
-         return Event::close_nowrite;
-        case FAN_OPEN:
-         return Event::open;
-        case FAN_CLOSE:
-         return Event::close;
-        /* TODO
-        case FAN_Q_OVERFLOW:
-        case FAN_OPEN_PERM:
-        case FAN_ONDIR:
-        case FAN_EVENT_ON_CHILD:
-        case FAN_ALL_CLASS_BITS:
-        */
-    }
-    return Event::none;
-}
-
-std::uint32_t
-EventHandler::convert(const Event event, std::function<std::uint32_t(Event)> translator) const
-{
-    std::uint32_t events = 0;
-    for (const auto& e : AllEvents) {
-        if ((event & e) == e) {
-            events = events | translator(e);
-        }
-    }
-    return events;
+    return fromFanotifyMask(e);
 }
 }
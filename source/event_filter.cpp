@@ -0,0 +1,413 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/event_filter.h>
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+namespace notifycpp {
+
+namespace {
+    std::string_view getFileName(std::string_view path)
+    {
+        const auto slash = path.rfind('/');
+        return slash == std::string_view::npos ? path : path.substr(slash + 1);
+    }
+
+    //! like std::filesystem::path::extension() without the dot
+    std::string_view getExtension(std::string_view path)
+    {
+        const auto name = getFileName(path);
+        const auto dot = name.rfind('.');
+        if (dot == std::string_view::npos || dot == 0 || name == "..")
+            return {};
+        return name.substr(dot + 1);
+    }
+
+    bool isUnder(std::string_view path, std::string_view prefix)
+    {
+        return path.compare(0, prefix.size(), prefix) == 0
+            && (path.size() == prefix.size() || path[prefix.size()] == '/' || prefix == "/");
+    }
+
+    bool isWordCharacter(char c)
+    {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '+' || c == '.' || c == '/';
+    }
+}
+
+/**
+ * @brief Recursive descent parser which emits the bytecode while parsing
+ *
+ * The value of the last predicate lives in one register. && and || jump
+ * over their right operand if the left one decides the result.
+ */
+class EventFilter::Compiler {
+public:
+    Compiler(EventFilter& filter)
+        : _Filter(filter)
+        , _Input(filter._Expression)
+        , _Position(0)
+    {
+    }
+
+    void compile()
+    {
+        parseExpression();
+        skipSpace();
+        if (_Position != _Input.size())
+            fail("unexpected input");
+    }
+
+private:
+    void parseExpression()
+    {
+        parseTerm();
+        std::vector<std::size_t> jumps;
+        while (accept("||")) {
+            jumps.push_back(emit(OpCode::jumpIfTrue));
+            parseTerm();
+        }
+        patch(jumps);
+    }
+
+    void parseTerm()
+    {
+        parseFactor();
+        std::vector<std::size_t> jumps;
+        while (accept("&&")) {
+            jumps.push_back(emit(OpCode::jumpIfFalse));
+            parseFactor();
+        }
+        patch(jumps);
+    }
+
+    void parseFactor()
+    {
+        if (accept("!")) {
+            parseFactor();
+            emit(OpCode::negate);
+        }
+        else if (accept("(")) {
+            parseExpression();
+            expect(")");
+        }
+        else {
+            parsePredicate();
+        }
+    }
+
+    void parsePredicate()
+    {
+        const auto start = _Position;
+        const std::string keyword = parseWord();
+        if (keyword == "true" || keyword == "false") {
+            emit(OpCode::constant, 0, keyword == "true");
+        }
+        else if (keyword == "ext") {
+            std::vector<std::string> extensions;
+            if (accept("==")) {
+                extensions.push_back(parseExtension());
+            }
+            else {
+                if (parseWord() != "in")
+                    fail("expected 'in' or '=='");
+                expect("{");
+                do {
+                    extensions.push_back(parseExtension());
+                } while (accept(","));
+                expect("}");
+            }
+            std::sort(std::begin(extensions), std::end(extensions));
+            _Filter._Sets.push_back(std::move(extensions));
+            emit(OpCode::extensionIn, _Filter._Sets.size() - 1);
+        }
+        else if (keyword == "name") {
+            expect("==");
+            _Filter._Strings.push_back(parseWord());
+            emit(OpCode::nameEquals, _Filter._Strings.size() - 1);
+        }
+        else if (keyword == "under") {
+            expect("(");
+            std::string prefix = parseWord();
+            while (prefix.size() > 1 && prefix.back() == '/')
+                prefix.pop_back();
+            expect(")");
+            _Filter._Strings.push_back(prefix);
+            emit(OpCode::under, _Filter._Strings.size() - 1);
+        }
+        else if (keyword == "glob") {
+            std::vector<std::string> patterns;
+            expect("(");
+            do {
+                patterns.push_back(parseWord());
+            } while (accept(","));
+            expect(")");
+            try {
+                _Filter._Globs.push_back(std::make_shared<GlobSet>(patterns));
+            }
+            catch (const std::invalid_argument& e) {
+                fail(e.what());
+            }
+            emit(OpCode::glob, _Filter._Globs.size() - 1);
+        }
+        else if (keyword == "event") {
+            const bool any = accept("&");
+            if (!any)
+                expect("==");
+            emit(any ? OpCode::eventAny : OpCode::eventEquals, static_cast<std::uint32_t>(parseEvents()));
+        }
+        else if (keyword == "size") {
+            static const std::pair<const char*, Compare> comparisons[] = {
+                { "<=", Compare::lessEqual }, { ">=", Compare::greaterEqual }, { "==", Compare::equal },
+                { "!=", Compare::notEqual }, { "<", Compare::less }, { ">", Compare::greater }
+            };
+            const auto comparison = std::find_if(std::begin(comparisons), std::end(comparisons),
+                [this](const std::pair<const char*, Compare>& c) { return accept(c.first); });
+            if (comparison == std::end(comparisons))
+                fail("expected a comparison");
+            const auto index = emit(OpCode::sizeCompare, 0, parseNumber());
+            _Filter._Code[index].compare = comparison->second;
+        }
+        else {
+            _Position = start;
+            fail("expected a predicate");
+        }
+    }
+
+    Event parseEvents()
+    {
+        if (!accept("("))
+            return parseEvent();
+
+        auto events = parseEvent();
+        while (accept("|"))
+            events = events | parseEvent();
+        expect(")");
+        return events;
+    }
+
+    Event parseEvent()
+    {
+        const auto start = _Position;
+        const std::string name = parseWord();
+        if (name == "delete_sub")
+            return Event::delete_sub;
+        for (const auto event : AllEvents) {
+            if (toString(event) == name)
+                return event;
+        }
+        _Position = start;
+        fail("unknown event '" + name + "'");
+        return Event::none;
+    }
+
+    std::string parseExtension()
+    {
+        std::string extension = parseWord();
+        if (!extension.empty() && extension.front() == '.')
+            extension.erase(0, 1);
+        return extension;
+    }
+
+    std::uint64_t parseNumber()
+    {
+        skipSpace();
+        const auto start = _Position;
+        std::uint64_t number = 0;
+        while (_Position < _Input.size() && std::isdigit(static_cast<unsigned char>(_Input[_Position])))
+            number = number * 10 + static_cast<std::uint64_t>(_Input[_Position++] - '0');
+        if (_Position == start)
+            fail("expected a number");
+
+        if (_Position < _Input.size()) {
+            const std::string units = "kMG";
+            const auto unit = units.find(_Input[_Position]);
+            if (unit != std::string::npos) {
+                number <<= 10 * (unit + 1);
+                ++_Position;
+            }
+        }
+        return number;
+    }
+
+    //! identifier or quoted string
+    std::string parseWord()
+    {
+        skipSpace();
+        if (_Position < _Input.size() && _Input[_Position] == '"') {
+            const auto end = _Input.find('"', _Position + 1);
+            if (end == std::string::npos)
+                fail("unterminated string");
+            std::string word = _Input.substr(_Position + 1, end - _Position - 1);
+            _Position = end + 1;
+            return word;
+        }
+
+        const auto start = _Position;
+        while (_Position < _Input.size() && isWordCharacter(_Input[_Position]))
+            ++_Position;
+        if (_Position == start)
+            fail("expected a word");
+        return _Input.substr(start, _Position - start);
+    }
+
+    void skipSpace()
+    {
+        while (_Position < _Input.size() && std::isspace(static_cast<unsigned char>(_Input[_Position])))
+            ++_Position;
+    }
+
+    bool accept(const std::string& token)
+    {
+        skipSpace();
+        if (_Input.compare(_Position, token.size(), token) != 0)
+            return false;
+        // '&' must not take the first half of '&&', '|' of '||'
+        if (token.size() == 1 && (token == "&" || token == "|") && _Position + 1 < _Input.size() && _Input[_Position + 1] == token[0])
+            return false;
+        _Position += token.size();
+        return true;
+    }
+
+    void expect(const std::string& token)
+    {
+        if (!accept(token))
+            fail("expected '" + token + "'");
+    }
+
+    std::size_t emit(OpCode op, std::size_t operand = 0, std::uint64_t value = 0)
+    {
+        _Filter._Code.push_back({ op, Compare::equal, static_cast<std::uint32_t>(operand), value });
+        return _Filter._Code.size() - 1;
+    }
+
+    void patch(const std::vector<std::size_t>& jumps)
+    {
+        for (const auto jump : jumps)
+            _Filter._Code[jump].operand = static_cast<std::uint32_t>(_Filter._Code.size());
+    }
+
+    [[noreturn]] void fail(const std::string& message) const
+    {
+        std::stringstream errorStream;
+        errorStream << "Invalid filter expression at position " << _Position << ": " << message << ": " << _Input;
+        throw std::invalid_argument(errorStream.str());
+    }
+
+    EventFilter& _Filter;
+    const std::string& _Input;
+    std::size_t _Position;
+};
+
+EventFilter::EventFilter(const std::string& expression)
+    : _Expression(expression)
+{
+    Compiler(*this).compile();
+}
+
+bool EventFilter::matches(std::string_view path, Event event) const
+{
+    const auto mask = static_cast<std::uint32_t>(event);
+    bool result = true;
+
+    std::size_t pc = 0;
+    while (pc < _Code.size()) {
+        const auto& instruction = _Code[pc++];
+        switch (instruction.op) {
+        case OpCode::constant:
+            result = instruction.value != 0;
+            break;
+        case OpCode::extensionIn: {
+            const auto& extensions = _Sets[instruction.operand];
+            result = std::binary_search(std::begin(extensions), std::end(extensions), getExtension(path));
+            break;
+        }
+        case OpCode::nameEquals:
+            result = getFileName(path) == _Strings[instruction.operand];
+            break;
+        case OpCode::under:
+            result = isUnder(path, _Strings[instruction.operand]);
+            break;
+        case OpCode::glob:
+            result = _Globs[instruction.operand]->matches(path);
+            break;
+        case OpCode::eventAny:
+            result = (mask & instruction.operand) != 0;
+            break;
+        case OpCode::eventEquals:
+            result = mask == instruction.operand;
+            break;
+        case OpCode::sizeCompare: {
+            std::error_code ec;
+            const auto size = std::filesystem::file_size(std::filesystem::path(path), ec);
+            if (ec) {
+                result = false;
+                break;
+            }
+            switch (instruction.compare) {
+            case Compare::less: result = size < instruction.value; break;
+            case Compare::lessEqual: result = size <= instruction.value; break;
+            case Compare::greater: result = size > instruction.value; break;
+            case Compare::greaterEqual: result = size >= instruction.value; break;
+            case Compare::equal: result = size == instruction.value; break;
+            case Compare::notEqual: result = size != instruction.value; break;
+            }
+            break;
+        }
+        case OpCode::jumpIfFalse:
+            if (!result)
+                pc = instruction.operand;
+            break;
+        case OpCode::jumpIfTrue:
+            if (result)
+                pc = instruction.operand;
+            break;
+        case OpCode::negate:
+            result = !result;
+            break;
+        }
+    }
+    return result;
+}
+
+bool EventFilter::matches(const FileSystemEvent& fse) const
+{
+    return matches(fse.getPath().native(), fse.getEvent());
+}
+
+const std::string& EventFilter::getExpression() const
+{
+    return _Expression;
+}
+
+std::size_t EventFilter::size() const
+{
+    return _Code.size();
+}
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/event_journal.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace notifycpp {
+
+namespace {
+    constexpr char Magic[8] = { 'N', 'C', 'P', 'P', 'J', 'R', 'N', '2' };
+    constexpr std::size_t SegmentHeaderSize = 16;
+
+    struct RecordHeader {
+        std::uint32_t size;
+        //! CRC32 of size and everything after this field up to the end of the path
+        std::uint32_t crc;
+        std::uint64_t sequence;
+        std::uint64_t timestamp;
+        std::uint32_t event;
+        std::int32_t pid;
+        std::uint32_t pathLength;
+        std::uint32_t reserved;
+    };
+    static_assert(sizeof(RecordHeader) == 40, "journal records are 8 byte aligned");
+
+    // A reader sees a record only after its size, stored last
+    std::uint32_t loadSize(const char* record)
+    {
+        return __atomic_load_n(reinterpret_cast<const std::uint32_t*>(record), __ATOMIC_ACQUIRE);
+    }
+
+    constexpr std::size_t CrcOffset = offsetof(RecordHeader, crc) + sizeof(std::uint32_t);
+
+    struct CrcTable {
+        std::uint32_t entries[256];
+
+        constexpr CrcTable()
+            : entries()
+        {
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320u : 0);
+                entries[i] = crc;
+            }
+        }
+    };
+    constexpr CrcTable Crc32Table;
+
+    //! CRC-32 (IEEE 802.3), continued from crc
+    std::uint32_t crc32(std::uint32_t crc, const char* data, std::size_t length)
+    {
+        crc = ~crc;
+        for (std::size_t i = 0; i < length; ++i)
+            crc = Crc32Table.entries[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    std::uint32_t recordCrc(const char* record, std::uint32_t size, std::uint32_t pathLength)
+    {
+        const std::uint32_t crc = crc32(0, reinterpret_cast<const char*>(&size), sizeof(size));
+        return crc32(crc, record + CrcOffset, sizeof(RecordHeader) - CrcOffset + pathLength);
+    }
+
+    /**
+     * A record is valid if it fits into the segment and its CRC matches,
+     * so a torn write after a power loss is never decoded.
+     *
+     * @return size of the record at offset, 0 at the end or a bad record
+     */
+    std::uint32_t validRecordSize(const char* segment, std::size_t segmentSize, std::size_t offset)
+    {
+        if (offset + sizeof(RecordHeader) > segmentSize)
+            return 0;
+        const std::uint32_t size = loadSize(segment + offset);
+        if (size < sizeof(RecordHeader) || offset + size > segmentSize)
+            return 0;
+
+        RecordHeader header;
+        memcpy(&header, segment + offset, sizeof(header));
+        if (sizeof(RecordHeader) + header.pathLength > size)
+            return 0;
+        return recordCrc(segment + offset, size, header.pathLength) == header.crc ? size : 0;
+    }
+
+    std::size_t recordSize(std::size_t pathLength)
+    {
+        return (sizeof(RecordHeader) + pathLength + 7) & ~std::size_t(7);
+    }
+
+    std::uint64_t realtimeNanoseconds()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+    }
+
+    std::string segmentName(std::uint64_t firstSequence)
+    {
+        char name[40];
+        snprintf(name, sizeof(name), "journal-%020llu.log", static_cast<unsigned long long>(firstSequence));
+        return name;
+    }
+
+    [[noreturn]] void throwError(const char* what, const std::filesystem::path& path)
+    {
+        std::stringstream errorStream;
+        errorStream << what << " '" << path.string() << "': " << strerror(errno) << ".";
+        throw std::runtime_error(errorStream.str());
+    }
+
+    /**
+     * Read-only mapping of a whole segment
+     */
+    class SegmentView {
+    public:
+        explicit SegmentView(const std::filesystem::path& path)
+        {
+            const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return;
+
+            struct stat st;
+            if (fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) > SegmentHeaderSize) {
+                void* data = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+                if (data != MAP_FAILED) {
+                    _Data = static_cast<const char*>(data);
+                    _Size = static_cast<std::size_t>(st.st_size);
+                }
+            }
+            close(fd);
+
+            if (_Data && memcmp(_Data, Magic, sizeof(Magic)) != 0) {
+                munmap(const_cast<char*>(_Data), _Size);
+                _Data = nullptr;
+            }
+        }
+
+        ~SegmentView()
+        {
+            if (_Data)
+                munmap(const_cast<char*>(_Data), _Size);
+        }
+
+        SegmentView(const SegmentView&) = delete;
+        SegmentView& operator=(const SegmentView&) = delete;
+
+        const char* data() const
+        {
+            return _Data;
+        }
+
+        std::size_t size() const
+        {
+            return _Size;
+        }
+
+    private:
+        const char* _Data = nullptr;
+        std::size_t _Size = 0;
+    };
+}
+
+EventJournal::EventJournal(const std::filesystem::path& directory, const EventJournalOptions& options)
+    : _Directory(directory)
+    , _Options(options)
+{
+    if (_Options.segmentSize < SegmentHeaderSize + recordSize(PATH_MAX))
+        throw std::invalid_argument("Journal segments are too small for a record");
+
+    std::filesystem::create_directories(_Directory);
+    recover();
+}
+
+EventJournal::~EventJournal()
+{
+    closeSegment();
+}
+
+std::vector<std::filesystem::path> EventJournal::getSegments() const
+{
+    std::vector<std::filesystem::path> segments;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(_Directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("journal-", 0) == 0 && entry.path().extension() == ".log")
+            segments.push_back(entry.path());
+    }
+    // zero padded sequence numbers sort like numbers
+    std::sort(std::begin(segments), std::end(segments));
+    return segments;
+}
+
+/**
+ * @brief Continue the newest segment after the last complete record
+ */
+void EventJournal::recover()
+{
+    const auto segments = getSegments();
+    if (segments.empty()) {
+        openSegment(_Directory / segmentName(1), true, 1);
+        return;
+    }
+
+    const std::uint64_t firstSequence = std::stoull(segments.back().stem().string().substr(8));
+    openSegment(segments.back(), false, firstSequence);
+    _LastSequence = firstSequence - 1;
+
+    // appending continues at the first bad record, overwriting a torn tail
+    while (const std::uint32_t size = validRecordSize(_Segment, _SegmentSize, _SegmentOffset)) {
+        _LastSequence = reinterpret_cast<const RecordHeader*>(_Segment + _SegmentOffset)->sequence;
+        _SegmentOffset += size;
+    }
+    // records behind a bad one must not come back once the tail is overwritten
+    if (_SegmentOffset + sizeof(RecordHeader) <= _SegmentSize && loadSize(_Segment + _SegmentOffset) != 0)
+        memset(_Segment + _SegmentOffset, 0, _SegmentSize - _SegmentOffset);
+}
+
+void EventJournal::openSegment(const std::filesystem::path& path, bool create, std::uint64_t firstSequence)
+{
+    const int fd = open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0)
+        throwError("Couldn't open journal segment", path);
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        throwError("Couldn't stat journal segment", path);
+    }
+
+    // Segments keep the size they were created with
+    if (create || static_cast<std::size_t>(st.st_size) < SegmentHeaderSize) {
+        if (ftruncate(fd, static_cast<off_t>(_Options.segmentSize)) < 0) {
+            close(fd);
+            throwError("Couldn't allocate journal segment", path);
+        }
+        _SegmentSize = _Options.segmentSize;
+    }
+    else {
+        _SegmentSize = static_cast<std::size_t>(st.st_size);
+    }
+
+    void* data = mmap(nullptr, _SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        throwError("Couldn't map journal segment", path);
+
+    _Segment = static_cast<char*>(data);
+    _SegmentOffset = SegmentHeaderSize;
+    if (memcmp(_Segment, Magic, sizeof(Magic)) != 0) {
+        // an existing segment of another format is never overwritten
+        if (std::any_of(_Segment, _Segment + SegmentHeaderSize, [](char c) { return c != 0; })) {
+            munmap(_Segment, _SegmentSize);
+            _Segment = nullptr;
+            errno = EINVAL;
+            throwError("Unknown journal segment format", path);
+        }
+        memcpy(_Segment, Magic, sizeof(Magic));
+        memcpy(_Segment + sizeof(Magic), &firstSequence, sizeof(firstSequence));
+    }
+}
+
+void EventJournal::closeSegment()
+{
+    if (!_Segment)
+        return;
+    msync(_Segment, _SegmentSize, MS_ASYNC);
+    munmap(_Segment, _SegmentSize);
+    _Segment = nullptr;
+}
+
+void EventJournal::rotate()
+{
+    closeSegment();
+    openSegment(_Directory / segmentName(_LastSequence + 1), true, _LastSequence + 1);
+
+    if (_Options.maxSegments == 0)
+        return;
+
+    auto segments = getSegments();
+    std::error_code ec;
+    for (std::size_t i = 0; i + _Options.maxSegments < segments.size(); ++i)
+        std::filesystem::remove(segments[i], ec);
+}
+
+std::uint64_t EventJournal::append(const FileSystemEvent& fse)
+{
+    const std::string path = fse.getPath().string();
+    const std::size_t pathLength = std::min<std::size_t>(path.size(), PATH_MAX);
+    const std::size_t size = recordSize(pathLength);
+
+    if (_SegmentOffset + size > _SegmentSize)
+        rotate();
+
+    char* record = _Segment + _SegmentOffset;
+    RecordHeader header;
+    header.size = 0;
+    header.crc = 0;
+    header.sequence = _LastSequence + 1;
+    header.timestamp = realtimeNanoseconds();
+    header.event = static_cast<std::uint32_t>(fse.getEvent());
+    header.pid = fse.getPid();
+    header.pathLength = static_cast<std::uint32_t>(pathLength);
+
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), path.data(), pathLength);
+    const std::uint32_t crc = recordCrc(record, static_cast<std::uint32_t>(size), header.pathLength);
+    memcpy(record + offsetof(RecordHeader, crc), &crc, sizeof(crc));
+    __atomic_store_n(reinterpret_cast<std::uint32_t*>(record), static_cast<std::uint32_t>(size), __ATOMIC_RELEASE);
+
+    _SegmentOffset += size;
+    return ++_LastSequence;
+}
+
+std::uint64_t EventJournal::getLastSequence() const
+{
+    return _LastSequence;
+}
+
+void EventJournal::sync()
+{
+    if (_Segment && msync(_Segment, _SegmentSize, MS_SYNC) < 0)
+        throwError("Couldn't sync journal", _Directory);
+}
+
+std::uint64_t EventJournal::replay(std::uint64_t from, const JournalObserver& observer) const
+{
+    const auto segments = getSegments();
+    std::uint64_t last = 0;
+
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        // skip segments which end before from
+        if (i + 1 < segments.size()) {
+            const std::uint64_t nextFirst = std::stoull(segments[i + 1].stem().string().substr(8));
+            if (nextFirst <= from)
+                continue;
+        }
+
+        const SegmentView segment(segments[i]);
+        if (!segment.data())
+            continue;
+
+        std::size_t offset = SegmentHeaderSize;
+        while (offset + sizeof(RecordHeader) <= segment.size() && loadSize(segment.data() + offset) != 0) {
+            // nothing after a bad record can be trusted
+            const std::uint32_t size = validRecordSize(segment.data(), segment.size(), offset);
+            if (size == 0)
+                return last;
+
+            RecordHeader header;
+            memcpy(&header, segment.data() + offset, sizeof(header));
+            if (header.sequence >= from) {
+                const std::filesystem::path path(std::string(segment.data() + offset + sizeof(header), header.pathLength));
+                observer({ header.sequence, header.timestamp,
+                    FileSystemEvent(path, static_cast<Event>(header.event), header.pid) });
+                last = header.sequence;
+            }
+            offset += size;
+        }
+    }
+    return last;
+}
+}
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/event_publisher.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <stdexcept>
+
+namespace notifycpp {
+
+struct Subscriber::Channel {
+    Channel(const SubscriberOptions& options, EventObserver observer)
+        : observer(std::move(observer))
+        , overflow(options.overflow)
+        , thread(options.thread)
+        , queue(options.queueSize)
+        , head(0)
+        , size(0)
+        , closed(false)
+        , delivered(0)
+        , dropped(0)
+        , failed(0)
+    {
+    }
+
+    EventObserver observer;
+    SubscriberOverflow overflow;
+    ThreadOptions thread;
+
+    //! ring buffer of SubscriberOptions::queueSize events
+    std::vector<TFileSystemEventPtr> queue;
+    std::size_t head;
+    std::size_t size;
+    bool closed;
+
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+
+    std::atomic<std::uint64_t> delivered;
+    std::atomic<std::uint64_t> dropped;
+    std::atomic<std::uint64_t> failed;
+};
+
+Subscriber::Subscriber(const SubscriberOptions& options, EventObserver observer)
+    : _Options(options)
+{
+    if (_Options.queueSize == 0)
+        throw std::invalid_argument("Subscriber queue size must not be 0");
+
+    for (const auto& path : _Options.paths) {
+        std::string prefix = path.string();
+        while (prefix.size() > 1 && prefix.back() == '/')
+            prefix.pop_back();
+        _Prefixes.push_back(prefix);
+    }
+    _Channel = std::make_shared<Channel>(_Options, std::move(observer));
+    _Thread = std::thread([channel = _Channel]() { run(channel); });
+}
+
+Subscriber::~Subscriber()
+{
+    close();
+}
+
+bool Subscriber::matches(const FileSystemEvent& fse) const
+{
+    const Event event = fse.getEvent();
+    if ((_Options.event & event) != event)
+        return false;
+
+    const std::string& native = fse.getPath().native();
+    const bool under = _Prefixes.empty() || std::any_of(std::begin(_Prefixes), std::end(_Prefixes), [&native](const std::string& prefix) {
+        return native.compare(0, prefix.size(), prefix) == 0
+            && (native.size() == prefix.size() || native[prefix.size()] == '/' || prefix == "/");
+    });
+    return under && (!_Options.filter || _Options.filter->matches(native, event));
+}
+
+void Subscriber::push(const TFileSystemEventPtr& event)
+{
+    Channel& channel = *_Channel;
+    std::unique_lock<std::mutex> lock(channel.mutex);
+    if (channel.overflow == SubscriberOverflow::block)
+        channel.notFull.wait(lock, [&channel]() { return channel.closed || channel.size < channel.queue.size(); });
+
+    if (channel.closed) {
+        ++channel.dropped;
+        return;
+    }
+    if (channel.size == channel.queue.size()) {
+        ++channel.dropped;
+        if (channel.overflow == SubscriberOverflow::dropNewest)
+            return;
+        channel.head = (channel.head + 1) % channel.queue.size();
+        --channel.size;
+    }
+    channel.queue[(channel.head + channel.size) % channel.queue.size()] = event;
+    ++channel.size;
+    lock.unlock();
+    channel.notEmpty.notify_one();
+}
+
+/**
+ * @brief Dispatch loop of the subscriber thread. It only touches the
+ *        channel, the Subscriber may be gone once the observer returns.
+ */
+void Subscriber::run(const std::shared_ptr<Channel>& shared)
+{
+    Channel& channel = *shared;
+    tryApplyThreadOptions(channel.thread);
+
+    std::unique_lock<std::mutex> lock(channel.mutex);
+    while (true) {
+        channel.notEmpty.wait(lock, [&channel]() { return channel.closed || channel.size > 0; });
+        if (channel.size == 0)
+            return;
+
+        auto event = std::move(channel.queue[channel.head]);
+        channel.head = (channel.head + 1) % channel.queue.size();
+        --channel.size;
+        lock.unlock();
+        channel.notFull.notify_one();
+
+        // the thread outlives a failing observer, std::terminate would not
+        try {
+            channel.observer({ event->getEvent(), *event });
+            channel.delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+        catch (...) {
+            channel.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        event.reset();
+        lock.lock();
+    }
+}
+
+void Subscriber::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(_Channel->mutex);
+        _Channel->closed = true;
+    }
+    _Channel->notEmpty.notify_all();
+    _Channel->notFull.notify_all();
+    if (!_Thread.joinable())
+        return;
+
+    // an observer closing or releasing its own subscriber can't join itself
+    if (_Thread.get_id() == std::this_thread::get_id())
+        _Thread.detach();
+    else
+        _Thread.join();
+}
+
+std::uint64_t Subscriber::getDelivered() const
+{
+    return _Channel->delivered.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Subscriber::getDropped() const
+{
+    return _Channel->dropped.load(std::memory_order_relaxed);
+}
+
+std::uint64_t Subscriber::getFailed() const
+{
+    return _Channel->failed.load(std::memory_order_relaxed);
+}
+
+std::size_t Subscriber::getPending() const
+{
+    std::lock_guard<std::mutex> lock(_Channel->mutex);
+    return _Channel->size;
+}
+
+EventPublisher::EventPublisher()
+    : _Subscribers(std::make_shared<const Subscribers>())
+{
+}
+
+EventPublisher::~EventPublisher()
+{
+    for (const auto& subscriber : *std::atomic_load(&_Subscribers))
+        subscriber->close();
+}
+
+TSubscriberPtr EventPublisher::subscribe(const SubscriberOptions& options, EventObserver observer)
+{
+    auto subscriber = std::make_shared<Subscriber>(options, std::move(observer));
+
+    std::lock_guard<std::mutex> lock(_Mutex);
+    auto subscribers = std::make_shared<Subscribers>(*std::atomic_load(&_Subscribers));
+    subscribers->push_back(subscriber);
+    std::atomic_store(&_Subscribers, std::shared_ptr<const Subscribers>(std::move(subscribers)));
+    return subscriber;
+}
+
+void EventPublisher::unsubscribe(const TSubscriberPtr& subscriber)
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        auto subscribers = std::make_shared<Subscribers>(*std::atomic_load(&_Subscribers));
+        subscribers->erase(std::remove(std::begin(*subscribers), std::end(*subscribers), subscriber), std::end(*subscribers));
+        std::atomic_store(&_Subscribers, std::shared_ptr<const Subscribers>(std::move(subscribers)));
+    }
+    if (subscriber)
+        subscriber->close();
+}
+
+void EventPublisher::publish(const TFileSystemEventPtr& event) const
+{
+    const auto subscribers = std::atomic_load(&_Subscribers);
+    for (const auto& subscriber : *subscribers) {
+        if (subscriber->matches(*event))
+            subscriber->push(event);
+    }
+}
+
+std::size_t EventPublisher::size() const
+{
+    return std::atomic_load(&_Subscribers)->size();
+}
+}
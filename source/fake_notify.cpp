@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/fake_notify.h>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+
+namespace notifycpp {
+
+FakeNotify::FakeNotify()
+    : _Now(0)
+    , _QueueLimit(0)
+    , _Overflowed(false)
+{
+}
+
+void FakeNotify::watchFile(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    if (isIgnored(fse.getPath()))
+        return;
+    _Watches.insert(fse.getPath());
+    NotifyCounters::set(_Counters.activeWatches, _Watches.size());
+}
+
+void FakeNotify::watchDirectory(const FileSystemEvent& fse)
+{
+    watchFile(fse);
+}
+
+void FakeNotify::unwatch(const FileSystemEvent& fse)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _Watches.erase(fse.getPath());
+    NotifyCounters::set(_Counters.activeWatches, _Watches.size());
+}
+
+bool FakeNotify::isWatched(const std::filesystem::path& path) const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Watches.count(path) > 0;
+}
+
+std::uint32_t FakeNotify::getEventMask(const Event event) const
+{
+    return static_cast<std::uint32_t>(event);
+}
+
+/**
+ * @brief Move all due events to the queue of Notify, like a read() of
+ *        the kernel queue, and return the first one
+ */
+TFileSystemEventPtr FakeNotify::getNextEvent()
+{
+    if (_Queue.empty()) {
+        std::unique_lock<std::mutex> lock(_Mutex);
+        _Wakeup.wait(lock, [this]() { return isStopped() || isDue(); });
+        if (isStopped())
+            return nullptr;
+
+        const auto readTime = pipelineClock();
+        NotifyCounters::add(_Counters.syscalls);
+        while (isDue()) {
+            auto event = std::move(_Pending.front().event);
+            _Pending.pop_front();
+            NotifyCounters::add(_Counters.eventsDecoded);
+            if (isIgnoredOnce(event->getPath()))
+                NotifyCounters::add(_Counters.eventsIgnored);
+            else if (!isFiltered(event->getPath(), event->getEvent()))
+                enqueue(std::move(event), readTime);
+        }
+        _Overflowed = false;
+    }
+    return dequeue();
+}
+
+void FakeNotify::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        Notify::stop();
+    }
+    _Wakeup.notify_all();
+}
+
+void FakeNotify::inject(const FileSystemEvent& fse, std::chrono::nanoseconds delay)
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        insert(_Now + delay, fse);
+    }
+    _Wakeup.notify_one();
+}
+
+void FakeNotify::injectAtRate(const FileSystemEvent& fse, std::size_t count, double perSecond)
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        const double interval = perSecond > 0 ? 1e9 / perSecond : 0;
+        for (std::size_t i = 0; i < count; ++i)
+            insert(_Now + std::chrono::nanoseconds(static_cast<std::int64_t>(static_cast<double>(i) * interval)), fse);
+    }
+    _Wakeup.notify_one();
+}
+
+void FakeNotify::insert(std::chrono::nanoseconds due, const FileSystemEvent& fse)
+{
+    if (_QueueLimit != 0 && _Pending.size() >= _QueueLimit) {
+        if (!_Overflowed)
+            NotifyCounters::add(_Counters.overflows);
+        _Overflowed = true;
+        NotifyCounters::add(_Counters.eventsIgnored);
+        return;
+    }
+
+    auto position = std::end(_Pending);
+    if (!_Pending.empty() && _Pending.back().due > due) {
+        position = std::upper_bound(std::begin(_Pending), std::end(_Pending), due,
+            [](std::chrono::nanoseconds time, const Pending& pending) { return time < pending.due; });
+    }
+    _Pending.insert(position, { due, std::make_shared<FileSystemEvent>(fse) });
+}
+
+bool FakeNotify::isDue() const
+{
+    return !_Pending.empty() && _Pending.front().due <= _Now;
+}
+
+void FakeNotify::advance(std::chrono::nanoseconds duration)
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Now += duration;
+    }
+    _Wakeup.notify_one();
+}
+
+std::chrono::nanoseconds FakeNotify::now() const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Now;
+}
+
+void FakeNotify::setQueueLimit(std::size_t limit)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    _QueueLimit = limit;
+}
+
+void FakeNotify::overflow()
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    NotifyCounters::add(_Counters.overflows);
+    NotifyCounters::add(_Counters.eventsIgnored, _Pending.size());
+    _Pending.clear();
+}
+
+void FakeNotify::reorder(std::uint64_t seed)
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    const auto due = std::find_if(std::begin(_Pending), std::end(_Pending),
+        [this](const Pending& pending) { return pending.due > _Now; });
+
+    std::mt19937_64 random(seed);
+    std::shuffle(std::begin(_Pending), due, random);
+}
+
+std::size_t FakeNotify::pending() const
+{
+    std::lock_guard<std::mutex> lock(_Mutex);
+    return _Pending.size();
+}
+}
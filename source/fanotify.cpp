@@ -32,41 +32,477 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <limits.h>
 #include <linux/version.h>
 #include <sys/fanotify.h>
 #include <sys/signalfd.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace notifycpp {
 
-Fanotify::Fanotify()
+namespace {
+    /**
+     * A cached verdict is only valid as long as the file content has not
+     * changed, therefore the modification time is part of the key. An
+     * open and an access of the same file are decided separately.
+     */
+    struct VerdictKey {
+        dev_t dev;
+        ino_t ino;
+        std::int64_t mtimeSec;
+        long mtimeNsec;
+        Event event;
+
+        bool operator==(const VerdictKey& other) const
+        {
+            return dev == other.dev && ino == other.ino
+                && mtimeSec == other.mtimeSec && mtimeNsec == other.mtimeNsec
+                && event == other.event;
+        }
+    };
+
+    struct VerdictKeyHash {
+        std::size_t operator()(const VerdictKey& key) const
+        {
+            std::size_t h = std::hash<std::uint64_t>()(key.ino);
+            h ^= std::hash<std::uint64_t>()(key.dev) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<std::int64_t>()(key.mtimeSec) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<long>()(key.mtimeNsec) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            h ^= std::hash<std::uint32_t>()(static_cast<std::uint32_t>(key.event)) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h;
+        }
+    };
+
+    struct PermissionRequest {
+        int fd;
+        bool cacheable;
+        VerdictKey key;
+        FileSystemEvent event;
+    };
+
+    /**
+     * Write all responses with a single writev(2) call per IOV_MAX
+     * responses. The fanotify device handles one response per iovec.
+     */
+    void writeResponses(int fanotifyFd, const std::vector<fanotify_response>& responses)
+    {
+        std::vector<iovec> iov;
+        iov.reserve(std::min<std::size_t>(responses.size(), IOV_MAX));
+
+        for (std::size_t offset = 0; offset < responses.size(); offset += IOV_MAX) {
+            iov.clear();
+            const std::size_t end = std::min<std::size_t>(responses.size(), offset + IOV_MAX);
+            for (std::size_t i = offset; i < end; ++i)
+                iov.push_back({const_cast<fanotify_response*>(&responses[i]), sizeof(fanotify_response)});
+
+            if (writev(fanotifyFd, iov.data(), static_cast<int>(iov.size())) < 0) {
+                std::stringstream errorStream;
+                errorStream << "Couldn't write fanotify response: " << strerror(errno) << ".";
+                throw std::runtime_error(errorStream.str());
+            }
+        }
+    }
+
+    std::uint32_t toResponse(Verdict verdict)
+    {
+        return verdict == Verdict::allow ? FAN_ALLOW : FAN_DENY;
+    }
+
+    /**
+     * Permission responses of one read batch. They are written and their
+     * fds closed when the batch ends, also if decoding it throws, as the
+     * processes opening the files stay blocked in open(2) otherwise.
+     */
+    class ResponseBatch {
+    public:
+        ResponseBatch(int fanotifyFd, NotifyCounters& counters)
+            : _FanotifyFd(fanotifyFd)
+            , _Counters(counters)
+        {
+        }
+
+        ~ResponseBatch()
+        {
+            try {
+                flush();
+            }
+            catch (const std::runtime_error&) {
+                NotifyCounters::add(_Counters.permissionErrors);
+            }
+        }
+
+        ResponseBatch(const ResponseBatch&) = delete;
+        ResponseBatch& operator=(const ResponseBatch&) = delete;
+
+        std::vector<fanotify_response>& responses()
+        {
+            return _Responses;
+        }
+
+        //! @throws std::runtime_error if writing fails, the fds are closed anyway
+        void flush()
+        {
+            std::vector<fanotify_response> responses;
+            responses.swap(_Responses);
+            if (responses.empty())
+                return;
+
+            std::exception_ptr error;
+            try {
+                writeResponses(_FanotifyFd, responses);
+            }
+            catch (const std::runtime_error&) {
+                error = std::current_exception();
+            }
+            for (const auto& response : responses)
+                close(response.fd);
+            if (error)
+                std::rethrow_exception(error);
+        }
+
+    private:
+        const int _FanotifyFd;
+        NotifyCounters& _Counters;
+        std::vector<fanotify_response> _Responses;
+    };
+
+    /**
+     * @return the pidfd of a FAN_EVENT_INFO_TYPE_PIDFD info record or -1
+     */
+    int getPidfd(const fanotify_event_metadata& metadata)
+    {
+#ifdef FAN_EVENT_INFO_TYPE_PIDFD
+        const char* info = reinterpret_cast<const char*>(&metadata) + metadata.metadata_len;
+        const char* end = reinterpret_cast<const char*>(&metadata) + metadata.event_len;
+
+        while (info + sizeof(fanotify_event_info_header) <= end) {
+            const auto* header = reinterpret_cast<const fanotify_event_info_header*>(info);
+            if (header->len == 0)
+                break;
+            if (header->info_type == FAN_EVENT_INFO_TYPE_PIDFD) {
+                const int pidfd = reinterpret_cast<const fanotify_event_info_pidfd*>(info)->pidfd;
+                return pidfd >= 0 ? pidfd : -1;
+            }
+            info += header->len;
+        }
+#else
+        (void)metadata;
+#endif
+        return -1;
+    }
+}
+
+/**
+ * @brief Decides permission events. If enabled, verdicts are looked up
+ *        in a cache keyed by inode, mtime and event first, cache misses
+ *        are answered by the permission handler either inline or by a
+ *        pool of workers.
+ */
+class VerdictEngine {
+public:
+    VerdictEngine(int fanotifyFd, Verdict fallback, NotifyCounters& counters)
+        : _FanotifyFd(fanotifyFd)
+        , _Fallback(fallback)
+        , _Counters(counters)
+        , _CacheSize(0)
+        , _Stopping(false)
+    {
+    }
+
+    ~VerdictEngine()
+    {
+        stopWorkers();
+    }
+
+    void setHandler(PermissionHandler handler)
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _Handler = std::move(handler);
+    }
+
+    void setCacheSize(std::size_t size)
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _CacheSize = size;
+        _Cache.clear();
+    }
+
+    void setWorkers(std::size_t count)
+    {
+        stopWorkers();
+        _Stopping = false;
+        for (std::size_t i = 0; i < count; ++i)
+            _Workers.emplace_back([this]() {
+                tryApplyThreadOptions(_ThreadOptions);
+                work();
+            });
+    }
+
+    //! restarts running workers with the new options
+    void setThreadOptions(const ThreadOptions& options)
+    {
+        const std::size_t count = _Workers.size();
+        stopWorkers();
+        _ThreadOptions = options;
+        if (count > 0)
+            setWorkers(count);
+    }
+
+    /**
+     * Either appends the verdict to responses or hands the request, and
+     * with it the event fd, over to a worker.
+     */
+    void decide(PermissionRequest request, std::vector<fanotify_response>& responses)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            if (request.cacheable) {
+                const auto cached = _Cache.find(request.key);
+                if (cached != _Cache.end()) {
+                    responses.push_back({request.fd, toResponse(cached->second)});
+                    return;
+                }
+            }
+
+            if (!_Workers.empty()) {
+                _Requests.push_back(std::move(request));
+                _Condition.notify_one();
+                return;
+            }
+        }
+
+        responses.push_back({request.fd, toResponse(evaluate(request))});
+    }
+
+private:
+    Verdict evaluate(const PermissionRequest& request)
+    {
+        PermissionHandler handler;
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            handler = _Handler;
+        }
+
+        Verdict verdict = Verdict::allow;
+        try {
+            if (handler)
+                verdict = handler(request.event);
+        }
+        catch (...) {
+            // a failed decision is not cached, the next access asks again
+            NotifyCounters::add(_Counters.permissionErrors);
+            return _Fallback;
+        }
+
+        if (request.cacheable) {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            if (_CacheSize > 0) {
+                if (_Cache.size() >= _CacheSize)
+                    _Cache.clear();
+                _Cache.emplace(request.key, verdict);
+            }
+        }
+        return verdict;
+    }
+
+    void work()
+    {
+        std::vector<PermissionRequest> requests;
+        std::vector<fanotify_response> responses;
+
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(_Mutex);
+                _Condition.wait(lock, [this]() { return _Stopping || !_Requests.empty(); });
+                if (_Requests.empty())
+                    return;
+
+                requests.assign(std::make_move_iterator(_Requests.begin()),
+                    std::make_move_iterator(_Requests.end()));
+                _Requests.clear();
+            }
+
+            responses.clear();
+            for (const auto& request : requests)
+                responses.push_back({request.fd, toResponse(evaluate(request))});
+
+            try {
+                writeResponses(_FanotifyFd, responses);
+            }
+            catch (const std::runtime_error&) {
+                // nobody to throw to, the kernel denies unanswered events when the group is closed
+                NotifyCounters::add(_Counters.permissionErrors);
+            }
+
+            for (const auto& request : requests)
+                close(request.fd);
+            requests.clear();
+        }
+    }
+
+    void stopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_Mutex);
+            _Stopping = true;
+        }
+        _Condition.notify_all();
+        for (auto& worker : _Workers)
+            worker.join();
+        _Workers.clear();
+    }
+
+    const int _FanotifyFd;
+    //! verdict if the permission handler throws
+    const Verdict _Fallback;
+    NotifyCounters& _Counters;
+
+    PermissionHandler _Handler;
+
+    std::unordered_map<VerdictKey, Verdict, VerdictKeyHash> _Cache;
+    std::size_t _CacheSize;
+
+    std::deque<PermissionRequest> _Requests;
+    std::vector<std::thread> _Workers;
+    ThreadOptions _ThreadOptions;
+    bool _Stopping;
+
+    std::mutex _Mutex;
+    std::condition_variable _Condition;
+};
+
+Fanotify::Fanotify(const FanotifyOptions& options)
     : Notify()
+    , _Options(options)
+    , _Buffer(std::max(sizeof(fanotify_event_metadata), options.bufferSize))
 {
     initFanotify();
+    _VerdictEngine = std::make_unique<VerdictEngine>(_FanotifyFd, _Options.fallbackVerdict, _Counters);
+    if (_Options.processInfo)
+        _ProcessCache = std::make_unique<ProcessCache>();
 }
 
 Fanotify::~Fanotify()
 {
+    // Workers have to answer their pending requests before the group is closed
+    _VerdictEngine.reset();
     close(_FanotifyFd);
 }
 
+void Fanotify::setPermissionHandler(PermissionHandler handler)
+{
+    _VerdictEngine->setHandler(std::move(handler));
+}
+
+/**
+ * @brief Answer permission events on the given number of threads instead
+ *        of the thread calling getNextEvent. The permission handler
+ *        has to be thread-safe if more than one worker is used.
+ */
+void Fanotify::setVerdictWorkers(std::size_t count)
+{
+    _VerdictEngine->setWorkers(count);
+}
+
+void Fanotify::setWorkerThreadOptions(const ThreadOptions& options)
+{
+    Notify::setWorkerThreadOptions(options);
+    _VerdictEngine->setThreadOptions(options);
+}
+
+void Fanotify::placeBuffers(bool lock)
+{
+    _Buffer.place(lock);
+}
+
+/**
+ * @brief Maximum number of cached verdicts, 0 disables the cache (the
+ *        default). Only enable it if the verdict depends on nothing but
+ *        the file content: a cached verdict is reused for every process.
+ */
+void Fanotify::setVerdictCacheSize(std::size_t size)
+{
+    _VerdictEngine->setCacheSize(size);
+}
+
+bool Fanotify::isPermissionClass() const
+{
+    return _Options.fanClass != FanotifyClass::notification;
+}
+
 void Fanotify::initFanotify()
 {
+    unsigned int flags = FAN_NONBLOCK;
+    if (_Options.unlimitedQueue)
+        flags |= FAN_UNLIMITED_QUEUE;
+    if (_Options.unlimitedMarks)
+        flags |= FAN_UNLIMITED_MARKS;
+
+    switch (_Options.fanClass) {
+    case FanotifyClass::notification:
+        flags |= FAN_CLASS_NOTIF;
+        break;
+    case FanotifyClass::content:
+        flags |= FAN_CLASS_CONTENT;
+        break;
+    case FanotifyClass::pre_content:
+        flags |= FAN_CLASS_PRE_CONTENT;
+        break;
+    }
+
 /**
  * Linux Kernel < 3.15.0 workaround
  * https://github.com/torvalds/linux/commit/1e2ee49f7f1b79f0b14884fe6a602f0411b39552
  */
 #if LINUX_VERSION_CODE < KERNEL_VERSION(3, 15, 0)
-    _FanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_NONBLOCK, O_RDONLY | 0100000);
+    const int eventFlags = O_RDONLY | 0100000;
 #else
-    _FanotifyFd = fanotify_init(FAN_CLASS_NOTIF | FAN_NONBLOCK, O_RDONLY | O_LARGEFILE);
+    const int eventFlags = O_RDONLY | O_LARGEFILE;
 #endif
 
+    // The kernel rejects FAN_REPORT_TID together with FAN_REPORT_PIDFD,
+    // and a tid can't be resolved to a pidfd by the process cache
+    if (_Options.reportTid && _Options.reportPidfd)
+        throw std::runtime_error("Couldn't setup new fanotify device: reportTid and reportPidfd are exclusive.");
+
+    unsigned int reportFlag = 0;
+#ifdef FAN_REPORT_TID
+    if (_Options.reportTid)
+        reportFlag = FAN_REPORT_TID;
+#else
+    _Options.reportTid = false;
+#endif
+#ifdef FAN_REPORT_PIDFD
+    if (_Options.reportPidfd)
+        reportFlag = FAN_REPORT_PIDFD;
+#else
+    _Options.reportPidfd = false;
+#endif
+
+    _FanotifyFd = fanotify_init(flags | reportFlag, eventFlags);
+
+    // Older kernels don't know the report flag, fall back to plain pids
+    // if it was the flag the kernel refused
+    if (_FanotifyFd == -1 && errno == EINVAL && reportFlag != 0) {
+        _FanotifyFd = fanotify_init(flags, eventFlags);
+        if (_FanotifyFd != -1) {
+            _Options.reportTid = false;
+            _Options.reportPidfd = false;
+        }
+    }
+
     if (_FanotifyFd == -1) {
         std::stringstream errorStream;
         errorStream << "Couldn't setup new fanotify device: " << strerror(errno) << ".";
@@ -84,7 +520,7 @@ void Fanotify::initFanotify()
  */
 void Fanotify::watchMountPoint(const FileSystemEvent& fse)
 {
-    watch(fse.getPath(), FAN_MARK_ADD | FAN_MARK_MOUNT);
+    watch(fse.getPath(), FAN_MARK_ADD | FAN_MARK_MOUNT, fse.getEvent());
 }
 
 /**
@@ -103,6 +539,28 @@ void Fanotify::watchFile(const FileSystemEvent& fse)
         watch(fse.getPath(), FAN_MARK_ADD, fse.getEvent());
 }
 
+/**
+ * @brief Watch the entries of a directory with FAN_EVENT_ON_CHILD. Create,
+ *        delete and move events can't be reported without FAN_REPORT_FID,
+ *        a directory watched for these only is skipped.
+ */
+void Fanotify::watchDirectory(const FileSystemEvent& fse)
+{
+    if (!checkWatchDirectory(fse))
+        return;
+
+    const std::uint32_t mask = getEventMask(fse.getEvent());
+    if (mask == 0)
+        return;
+
+    if (fanotify_mark(_FanotifyFd, FAN_MARK_ADD, mask | FAN_EVENT_ON_CHILD, AT_FDCWD, fse.getPath().c_str()) < 0) {
+        std::stringstream errorStream;
+        errorStream << "Couldn't add monitor '" << fse.getPath() << "': " << strerror(errno);
+        throw std::runtime_error(errorStream.str());
+    }
+    NotifyCounters::add(_Counters.activeWatches);
+}
+
 void Fanotify::watch(const std::filesystem::path& path, unsigned int flags, const Event event)
 {
     /* Add new fanotify mark */
@@ -111,6 +569,7 @@ void Fanotify::watch(const std::filesystem::path& path, unsigned int flags, cons
         errorStream << "Couldn't add monitor '" << path << "': " << strerror(errno);
         throw std::runtime_error(errorStream.str());
     }
+    NotifyCounters::add(_Counters.activeWatches);
 }
 
 /**
@@ -128,6 +587,39 @@ void Fanotify::unwatch(const FileSystemEvent& fse)
         errorStream << "Couldn't remove monitor '" << fse.getPath() << "': " << strerror(errno);
         throw std::runtime_error(errorStream.str());
     }
+    if (_Counters.activeWatches.load(std::memory_order_relaxed) > 0)
+        _Counters.activeWatches.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Ignore all events of the given path. Besides the user space
+ *        filter an ignore mark is added to the inode, so the kernel
+ *        drops the events before they are queued for this group.
+ *
+ * @param path that will be ignored
+ *
+ */
+void Fanotify::ignore(const std::filesystem::path& path)
+{
+    Notify::ignore(path);
+
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+        return;
+
+    unsigned int flags = FAN_MARK_ADD | FAN_MARK_IGNORED_MASK;
+    if (_Options.ignoreSurviveModify)
+        flags |= FAN_MARK_IGNORED_SURV_MODIFY;
+
+    std::uint32_t mask = FAN_ACCESS | FAN_MODIFY | FAN_CLOSE | FAN_OPEN;
+    if (isPermissionClass())
+        mask |= FAN_OPEN_PERM | FAN_ACCESS_PERM;
+
+    if (fanotify_mark(_FanotifyFd, flags, mask, AT_FDCWD, path.c_str()) < 0) {
+        std::stringstream errorStream;
+        errorStream << "Couldn't add ignore mark '" << path << "': " << strerror(errno);
+        throw std::runtime_error(errorStream.str());
+    }
 }
 
 /**
@@ -142,65 +634,154 @@ void Fanotify::unwatch(const FileSystemEvent& fse)
  */
 TFileSystemEventPtr Fanotify::getNextEvent()
 {
-    struct pollfd fds[FD_POLL_MAX];
-    /* Setup polling */
-    fds[FD_POLL_FANOTIFY].fd = _FanotifyFd;
-    fds[FD_POLL_FANOTIFY].events = POLLIN;
-
-    /* Now loop */
     while (_Queue.empty() && isRunning()) {
-        /* Block until there is something to be read */
-        if (poll(fds, FD_POLL_MAX, mThreadSleep) < 0) {
-            std::stringstream errorStream;
-            errorStream << "Couldn't poll(): " << strerror(errno) << ".";
-            throw std::runtime_error(errorStream.str());
-        }
+        /* Read all events available up to the buffer size, spinning
+         * within the spin budget and blocking afterwards. */
+        ssize_t length = readEvents(_FanotifyFd, _Buffer.data(), _Buffer.size());
+        if (length <= 0)
+            continue;
+
+        const std::uint64_t readTime = pipelineClock();
+
+        auto metadata = reinterpret_cast<const fanotify_event_metadata*>(_Buffer.data());
+        ResponseBatch batch(_FanotifyFd, _Counters);
+        std::exception_ptr error;
+
+        if (_ProcessCache)
+            _ProcessCache->sweep();
 
-        if (isStopped()) {
-            return nullptr;
+        // a single record can't have a duplicate
+        const bool deduplicate = _Deduplicate && length > static_cast<ssize_t>(metadata->event_len);
+        if (deduplicate)
+            beginBatch();
+
+        // Permission events have to be answered even if we are stopping or a record fails
+        while (FAN_EVENT_OK(metadata, length)) {
+            try {
+                decodeRecord(*metadata, readTime, deduplicate, batch.responses());
+            }
+            catch (...) {
+                // nothing after handlePermission throws, so the event is still unanswered
+                if (metadata->mask & (FAN_OPEN_PERM | FAN_ACCESS_PERM))
+                    batch.responses().push_back({ metadata->fd, toResponse(_Options.fallbackVerdict) });
+                if (!error)
+                    error = std::current_exception();
+            }
+            metadata = FAN_EVENT_NEXT(metadata, length);
         }
 
-        /* fanotify event received? */
-        if (fds[FD_POLL_FANOTIFY].revents & POLLIN) {
-            std::vector<char> buffer(_fanotify_buffer_size);
-            ssize_t length;
+        batch.flush();
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    return dequeue();
+}
 
-            /* Read from the FD. It will read all events available up to
-             * the given buffer size. */
-            if ((length = read(fds[FD_POLL_FANOTIFY].fd, buffer.data(), _fanotify_buffer_size)) > 0) {
 
-                auto metadata = reinterpret_cast<fanotify_event_metadata*>(buffer.data());
+/**
+ * @brief Decode one fanotify record and queue its events. Permission
+ *        events are answered inline into responses or handed to a
+ *        verdict worker.
+ */
+void Fanotify::decodeRecord(const fanotify_event_metadata& metadata,
+    std::uint64_t readTime,
+    bool deduplicate,
+    std::vector<fanotify_response>& responses)
+{
+    NotifyCounters::add(_Counters.eventsDecoded);
+    if (metadata.mask & FAN_Q_OVERFLOW)
+        NotifyCounters::add(_Counters.overflows);
 
-                while (FAN_EVENT_OK(metadata, length) && isRunning()) {
+    const std::string filename = getFilePath(metadata.fd);
+    const std::filesystem::path path(filename);
+    const pid_t pid = metadata.pid;
+    const TProcessInfoPtr processInfo = getProcessInfo(metadata);
 
-                    const std::string filename = getFilePath(metadata->fd);
-                    const std::filesystem::path path(filename);
-                    if (!filename.empty() && !isIgnoredOnce(path)) {
-                        for (const Event event : _EventHandler.getFanotifyEvents(static_cast<uint32_t>(metadata->mask)))
-                            if (event != Event::none)
-                                _Queue.push(std::make_shared<FileSystemEvent>(path , event));
-                        close(metadata->fd);
-                    }
-                    metadata = FAN_EVENT_NEXT(metadata, length);
-                }
+    if (metadata.mask & (FAN_OPEN_PERM | FAN_ACCESS_PERM)) {
+        handlePermission(metadata, path, processInfo, responses);
+    }
+    else {
+        // The inode is taken from the event fd before it is closed
+        struct stat st;
+        const bool hasInode = deduplicate && metadata.fd >= 0 && fstat(metadata.fd, &st) == 0;
+
+        // The fd is shared by all events of this metadata and closed with the last one
+        TFileDescriptorPtr fd;
+        if (_Options.keepEventFd && metadata.fd >= 0)
+            fd = std::make_shared<FileDescriptor>(metadata.fd);
+        else if (metadata.fd >= 0)
+            close(metadata.fd);
+
+        const Event decoded = fromFanotifyMask(static_cast<uint32_t>(metadata.mask));
+        if (decoded != Event::none && !filename.empty() && isRunning() && !isIgnoredOnce(path)) {
+            // fanotify merges events, every single event is queued on its own
+            for (auto bits = static_cast<std::uint32_t>(decoded); bits != 0; bits &= bits - 1) {
+                const auto event = static_cast<Event>(bits & (~bits + 1));
+                if (isFiltered(path, event) || (hasInode && isDuplicate(st.st_dev, st.st_ino, event)))
+                    continue;
+                auto fse = std::make_shared<FileSystemEvent>(path, event, pid);
+                fse->setProcessInfo(processInfo);
+                fse->setFileDescriptor(fd);
+                enqueue(fse, readTime);
             }
         }
+        else {
+            NotifyCounters::add(_Counters.eventsIgnored);
+        }
     }
+}
 
-    if (isStopped() || _Queue.empty()) {
-        return nullptr;
+/**
+ * @brief Answer a FAN_OPEN_PERM or FAN_ACCESS_PERM event. Inline verdicts
+ *        are appended to responses and written in one batch by the
+ *        caller, which closes their fds afterwards. Requests handed to a
+ *        verdict worker are answered and closed by the worker.
+ */
+void Fanotify::handlePermission(const fanotify_event_metadata& metadata,
+    const std::filesystem::path& path,
+    const TProcessInfoPtr& processInfo,
+    std::vector<fanotify_response>& responses)
+{
+    const Event event = (metadata.mask & FAN_OPEN_PERM) ? Event::open : Event::access;
+    PermissionRequest request { metadata.fd, false, {}, FileSystemEvent(path, event, metadata.pid) };
+    request.event.setProcessInfo(processInfo);
+
+    struct stat st;
+    if (fstat(metadata.fd, &st) == 0) {
+        request.cacheable = true;
+        request.key = { st.st_dev, st.st_ino, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, event };
     }
 
-    // Return next event
-    auto event = _Queue.front();
-    _Queue.pop();
-    return event;
+    _VerdictEngine->decide(std::move(request), responses);
 }
 
+/**
+ * @brief Resolve the process of an event through the process cache. A
+ *        pidfd reported by the kernel is handed over to the cache or
+ *        closed if attribution is disabled.
+ */
+TProcessInfoPtr Fanotify::getProcessInfo(const fanotify_event_metadata& metadata)
+{
+    const int pidfd = getPidfd(metadata);
+    if (!_ProcessCache) {
+        if (pidfd >= 0)
+            close(pidfd);
+        return nullptr;
+    }
+    return _ProcessCache->lookup(metadata.pid, pidfd);
+}
 
 std::uint32_t
 Fanotify::getEventMask(const Event event) const
 {
-    return _EventHandler.convertToFanotifyEvents(event);
+    std::uint32_t mask = _EventHandler.convertToFanotifyEvents(event);
+    if (isPermissionClass()) {
+        if (mask & FAN_OPEN)
+            mask |= FAN_OPEN_PERM;
+        if (mask & FAN_ACCESS)
+            mask |= FAN_ACCESS_PERM;
+    }
+    return mask;
 }
 }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/file_descriptor.h>
+
+#include <unistd.h>
+
+namespace notifycpp {
+
+FileDescriptor::FileDescriptor()
+    : _Fd(-1)
+{
+}
+
+FileDescriptor::FileDescriptor(int fd)
+    : _Fd(fd)
+{
+}
+
+FileDescriptor::~FileDescriptor()
+{
+    reset();
+}
+
+FileDescriptor::FileDescriptor(FileDescriptor&& other) noexcept
+    : _Fd(other.release())
+{
+}
+
+FileDescriptor& FileDescriptor::operator=(FileDescriptor&& other) noexcept
+{
+    if (this != &other)
+        reset(other.release());
+    return *this;
+}
+
+int FileDescriptor::get() const
+{
+    return _Fd;
+}
+
+int FileDescriptor::release()
+{
+    const int fd = _Fd;
+    _Fd = -1;
+    return fd;
+}
+
+void FileDescriptor::reset(int fd)
+{
+    if (_Fd >= 0)
+        close(_Fd);
+    _Fd = fd;
+}
+
+FileDescriptor::operator bool() const
+{
+    return _Fd >= 0;
+}
+}
@@ -28,6 +28,7 @@ namespace notifycpp {
 FileSystemEvent::FileSystemEvent(const std::filesystem::path& p)
     : _Event(Event::open)
     , _Path(p)
+    , _Pid(0)
 {
 }
 
@@ -35,6 +36,16 @@ FileSystemEvent::FileSystemEvent(const std::filesystem::path& p,
     const Event event)
     : _Event(event)
     , _Path(p)
+    , _Pid(0)
+{
+}
+
+FileSystemEvent::FileSystemEvent(const std::filesystem::path& p,
+    const Event event,
+    pid_t pid)
+    : _Event(event)
+    , _Path(p)
+    , _Pid(pid)
 {
 }
 
@@ -47,9 +58,46 @@ Event FileSystemEvent::getEvent() const
     return _Event;
 }
 
-std::filesystem::path
+const std::filesystem::path&
 FileSystemEvent::getPath() const
 {
     return _Path;
 }
+
+pid_t FileSystemEvent::getPid() const
+{
+    return _Pid;
+}
+
+TProcessInfoPtr FileSystemEvent::getProcessInfo() const
+{
+    return _ProcessInfo;
+}
+
+void FileSystemEvent::setProcessInfo(TProcessInfoPtr info)
+{
+    _ProcessInfo = std::move(info);
+}
+
+TFileDescriptorPtr FileSystemEvent::getFileDescriptor() const
+{
+    return _FileDescriptor;
+}
+
+void FileSystemEvent::setFileDescriptor(TFileDescriptorPtr fd)
+{
+    _FileDescriptor = std::move(fd);
+}
+
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+const PipelineTimestamps& FileSystemEvent::getTimestamps() const
+{
+    return _Timestamps;
+}
+
+void FileSystemEvent::setTimestamps(const PipelineTimestamps& timestamps)
+{
+    _Timestamps = timestamps;
+}
+#endif
 }
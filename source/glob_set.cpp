@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/glob_set.h>
+
+#include <algorithm>
+#include <queue>
+#include <sstream>
+#include <stdexcept>
+
+namespace notifycpp {
+
+namespace {
+    bool hasMeta(std::string_view pattern)
+    {
+        return pattern.find_first_of("*?[\\") != std::string_view::npos;
+    }
+
+    [[noreturn]] void invalidPattern(const std::string& pattern, const std::string& message)
+    {
+        std::stringstream errorStream;
+        errorStream << "Invalid glob pattern '" << pattern << "': " << message;
+        throw std::invalid_argument(errorStream.str());
+    }
+
+    //! calls f with the start and end of every component, stops if f returns true
+    template <typename F>
+    bool anyComponent(std::string_view path, F f)
+    {
+        std::size_t begin = 0;
+        while (begin <= path.size()) {
+            auto end = path.find('/', begin);
+            if (end == std::string_view::npos)
+                end = path.size();
+            if (end > begin && f(path.substr(begin, end - begin)))
+                return true;
+            begin = end + 1;
+        }
+        return false;
+    }
+}
+
+GlobSet::GlobSet(const std::vector<std::string>& patterns)
+    : _Nodes(1)
+{
+    for (const auto& pattern : patterns)
+        addPattern(pattern);
+    buildAutomaton();
+    _Size = patterns.size();
+}
+
+std::string_view GlobSet::store(std::string_view literal)
+{
+    _Literals.emplace_back(literal);
+    return _Literals.back();
+}
+
+void GlobSet::addPattern(const std::string& pattern)
+{
+    if (pattern.empty())
+        invalidPattern(pattern, "empty pattern");
+    if (pattern.front() == '!')
+        invalidPattern(pattern, "negated patterns are not supported");
+
+    std::string_view trimmed(pattern);
+    while (trimmed.size() > 1 && trimmed.back() == '/')
+        trimmed.remove_suffix(1);
+
+    const bool component = trimmed.find('/') == std::string_view::npos;
+    const bool anchored = trimmed.front() == '/' || trimmed.compare(0, 2, "**") == 0;
+
+    if (!hasMeta(trimmed)) {
+        if (component) {
+            _Names.insert(store(trimmed));
+            return;
+        }
+        if (anchored) {
+            _Paths.insert(store(trimmed));
+            return;
+        }
+    }
+    else if (component && trimmed.size() > 2 && trimmed[0] == '*' && trimmed[1] == '.' && !hasMeta(trimmed.substr(1))) {
+        _Suffixes.insert(store(trimmed.substr(1)));
+        return;
+    }
+
+    std::string literal;
+    _Globs.push_back(compile(trimmed, component, !component && !anchored, literal));
+    const auto glob = static_cast<std::uint32_t>(_Globs.size() - 1);
+    if (literal.empty())
+        _Unfiltered.push_back(glob);
+    else
+        addLiteral(literal, glob);
+}
+
+GlobSet::Glob GlobSet::compile(std::string_view pattern, bool component, bool floating, std::string& longestLiteral)
+{
+    Glob glob { {}, component, floating };
+    std::string literal;
+    const auto endLiteral = [&]() {
+        if (literal.size() > longestLiteral.size())
+            longestLiteral = literal;
+        literal.clear();
+    };
+
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+        char c = pattern[i];
+        if (c == '*') {
+            endLiteral();
+            const bool globstar = i + 1 < pattern.size() && pattern[i + 1] == '*';
+            while (i + 1 < pattern.size() && pattern[i + 1] == '*')
+                ++i;
+            glob.tokens.push_back({ globstar && !component ? TokenType::globstar : TokenType::star, 0, 0 });
+        }
+        else if (c == '?') {
+            endLiteral();
+            glob.tokens.push_back({ TokenType::any, 0, 0 });
+        }
+        else if (c == '[') {
+            endLiteral();
+            std::array<bool, 256> characters {};
+            std::size_t j = i + 1;
+            const bool negated = j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^');
+            if (negated)
+                ++j;
+            const auto first = j;
+            for (; j < pattern.size() && (pattern[j] != ']' || j == first); ++j) {
+                auto from = static_cast<unsigned char>(pattern[j]);
+                auto to = from;
+                if (j + 2 < pattern.size() && pattern[j + 1] == '-' && pattern[j + 2] != ']') {
+                    to = static_cast<unsigned char>(pattern[j + 2]);
+                    j += 2;
+                }
+                for (unsigned int k = from; k <= to; ++k)
+                    characters[k] = true;
+            }
+            if (j >= pattern.size())
+                invalidPattern(std::string(pattern), "unterminated character class");
+            if (negated) {
+                for (auto& character : characters)
+                    character = !character;
+            }
+            _Classes.push_back(characters);
+            glob.tokens.push_back({ TokenType::characterClass, 0, static_cast<std::uint32_t>(_Classes.size() - 1) });
+            i = j;
+        }
+        else {
+            if (c == '\\' && i + 1 < pattern.size())
+                c = pattern[++i];
+            literal.push_back(c);
+            glob.tokens.push_back({ TokenType::literal, c, 0 });
+        }
+    }
+    endLiteral();
+    return glob;
+}
+
+void GlobSet::addLiteral(const std::string& literal, std::uint32_t glob)
+{
+    std::uint32_t node = 0;
+    for (const char c : literal) {
+        auto& next = _Nodes[node].next;
+        auto it = std::lower_bound(std::begin(next), std::end(next), c,
+            [](const std::pair<char, std::uint32_t>& edge, char character) { return edge.first < character; });
+        if (it != std::end(next) && it->first == c) {
+            node = it->second;
+            continue;
+        }
+        const auto child = static_cast<std::uint32_t>(_Nodes.size());
+        next.insert(it, { c, child });
+        // next lives in _Nodes, insert before growing it
+        _Nodes.emplace_back();
+        _Nodes[child].depth = _Nodes[node].depth + 1;
+        node = child;
+    }
+    _Nodes[node].globs.push_back(glob);
+}
+
+std::uint32_t GlobSet::step(std::uint32_t node, char c) const
+{
+    while (true) {
+        const auto& next = _Nodes[node].next;
+        const auto it = std::lower_bound(std::begin(next), std::end(next), c,
+            [](const std::pair<char, std::uint32_t>& edge, char character) { return edge.first < character; });
+        if (it != std::end(next) && it->first == c)
+            return it->second;
+        if (node == 0)
+            return 0;
+        node = _Nodes[node].fail;
+    }
+}
+
+/**
+ * @brief Set the fail and output links of the Aho-Corasick automaton in
+ *        breadth first order
+ */
+void GlobSet::buildAutomaton()
+{
+    std::queue<std::uint32_t> queue;
+    for (const auto& edge : _Nodes[0].next) {
+        _StartBytes[static_cast<unsigned char>(edge.first)] = true;
+        queue.push(edge.second);
+    }
+
+    while (!queue.empty()) {
+        const auto node = queue.front();
+        queue.pop();
+        for (const auto& edge : _Nodes[node].next) {
+            const auto child = edge.second;
+            const auto fail = node == 0 ? 0 : step(_Nodes[node].fail, edge.first);
+            _Nodes[child].fail = fail;
+            _Nodes[child].output = _Nodes[fail].globs.empty() ? _Nodes[fail].output : fail;
+            queue.push(child);
+        }
+    }
+}
+
+bool GlobSet::matches(std::string_view path) const
+{
+    while (path.size() > 1 && path.back() == '/')
+        path.remove_suffix(1);
+
+    if (matchesComponents(path) || matchesPaths(path))
+        return true;
+
+    for (const auto glob : _Unfiltered) {
+        if (verifyAnywhere(_Globs[glob], path))
+            return true;
+    }
+
+    if (_Nodes.size() <= 1)
+        return false;
+
+    std::uint32_t node = 0;
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        const char c = path[i];
+        if (node == 0 && !_StartBytes[static_cast<unsigned char>(c)])
+            continue;
+        node = step(node, c);
+        for (auto out = node; out != 0; out = _Nodes[out].output) {
+            for (const auto glob : _Nodes[out].globs) {
+                if (verify(_Globs[glob], path, i + 1))
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool GlobSet::matchesComponents(std::string_view path) const
+{
+    if (_Names.empty() && _Suffixes.empty())
+        return false;
+
+    return anyComponent(path, [this](std::string_view component) {
+        if (_Names.count(component))
+            return true;
+        for (auto dot = component.find('.'); dot != std::string_view::npos; dot = component.find('.', dot + 1)) {
+            if (_Suffixes.count(component.substr(dot)))
+                return true;
+        }
+        return false;
+    });
+}
+
+bool GlobSet::matchesPaths(std::string_view path) const
+{
+    if (_Paths.empty())
+        return false;
+
+    if (_Paths.count(path))
+        return true;
+    for (auto slash = path.find('/', 1); slash != std::string_view::npos; slash = path.find('/', slash + 1)) {
+        if (_Paths.count(path.substr(0, slash)))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Run a glob whose literal ends at literalEnd against the path
+ */
+bool GlobSet::verify(const Glob& glob, std::string_view path, std::size_t literalEnd) const
+{
+    if (glob.component) {
+        // the literal has no '/', it lies within one component
+        const auto slash = path.rfind('/', literalEnd - 1);
+        const auto begin = slash == std::string_view::npos ? 0 : slash + 1;
+        auto end = path.find('/', literalEnd);
+        if (end == std::string_view::npos)
+            end = path.size();
+        return matchTokens(glob.tokens, 0, path.substr(begin, end - begin), 0, false);
+    }
+    return verifyAnywhere(glob, path);
+}
+
+bool GlobSet::verifyAnywhere(const Glob& glob, std::string_view path) const
+{
+    if (glob.component)
+        return anyComponent(path, [&](std::string_view component) { return matchTokens(glob.tokens, 0, component, 0, false); });
+
+    if (!glob.floating)
+        return matchTokens(glob.tokens, 0, path, 0, true);
+
+    for (std::size_t begin = 0; begin < path.size(); ++begin) {
+        if ((begin == 0 || path[begin - 1] == '/') && path[begin] != '/' && matchTokens(glob.tokens, 0, path, begin, true))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Backtracking match of tokens from token against text from position
+ * @param prefix also accept a match of a parent directory of text
+ */
+bool GlobSet::matchTokens(const std::vector<Token>& tokens, std::size_t token, std::string_view text, std::size_t position, bool prefix) const
+{
+    for (; token < tokens.size(); ++token) {
+        const auto& t = tokens[token];
+        switch (t.type) {
+        case TokenType::literal:
+            if (position == text.size() || text[position] != t.literal)
+                return false;
+            ++position;
+            break;
+        case TokenType::any:
+            if (position == text.size() || text[position] == '/')
+                return false;
+            ++position;
+            break;
+        case TokenType::characterClass:
+            if (position == text.size() || text[position] == '/' || !_Classes[t.characterClass][static_cast<unsigned char>(text[position])])
+                return false;
+            ++position;
+            break;
+        case TokenType::star:
+            for (auto end = position;; ++end) {
+                if (matchTokens(tokens, token + 1, text, end, prefix))
+                    return true;
+                if (end == text.size() || text[end] == '/')
+                    return false;
+            }
+        case TokenType::globstar:
+            // "a/**/b" also matches "a/b"
+            if (token + 1 < tokens.size() && tokens[token + 1].type == TokenType::literal && tokens[token + 1].literal == '/'
+                && matchTokens(tokens, token + 2, text, position, prefix))
+                return true;
+            for (auto end = position; end <= text.size(); ++end) {
+                if (matchTokens(tokens, token + 1, text, end, prefix))
+                    return true;
+            }
+            return false;
+        }
+    }
+    return position == text.size() || (prefix && text[position] == '/');
+}
+
+std::size_t GlobSet::size() const
+{
+    return _Size;
+}
+
+bool GlobSet::empty() const
+{
+    return _Size == 0;
+}
+}
@@ -9,6 +9,7 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -16,6 +17,7 @@ namespace notifycpp {
 Inotify::Inotify()
     : mError(0)
     , mInotifyFd(0)
+    , _Buffer(EVENT_BUF_LEN)
 {
     // Initialize inotify
     init();
@@ -73,15 +75,21 @@ void Inotify::watchFile(const FileSystemEvent& fse)
     }
 
     mDirectorieMap.emplace(wd, fse.getPath());
+    rememberInode(wd, fse.getPath());
+    NotifyCounters::set(_Counters.activeWatches, mDirectorieMap.size());
 }
 
+/**
+ * @brief Adds a watch for the entries of a directory. The event mask is
+ *        added to the mask of an existing watch of the directory.
+ */
 void Inotify::watchDirectory(const FileSystemEvent& fse)
 {
     if (!checkWatchDirectory(fse))
         return;
 
     mError = 0;
-    const int wd = inotify_add_watch(mInotifyFd, fse.getPath().c_str(), getEventMask(fse.getEvent()));
+    const int wd = inotify_add_watch(mInotifyFd, fse.getPath().c_str(), getEventMask(fse.getEvent()) | IN_MASK_ADD);
 
     if (wd == -1) {
         mError = errno;
@@ -98,6 +106,8 @@ void Inotify::watchDirectory(const FileSystemEvent& fse)
     }
 
     mDirectorieMap.emplace(wd, fse.getPath());
+    rememberInode(wd, fse.getPath());
+    NotifyCounters::set(_Counters.activeWatches, mDirectorieMap.size());
 }
 
 void Inotify::unwatch(const FileSystemEvent& fse)
@@ -127,6 +137,36 @@ void Inotify::removeWatch(int wd)
         errorStream << "Failed to remove watch! " << strerror(mError) << ".";
         throw std::runtime_error(errorStream.str());
     }
+    mDirectorieMap.erase(wd);
+    mWatchInodes.erase(wd);
+    NotifyCounters::set(_Counters.activeWatches, mDirectorieMap.size());
+}
+
+/**
+ * @brief Remember the inode of a watch, the events on the watched
+ *        file itself are deduplicated by it without a stat
+ */
+void Inotify::rememberInode(int wd, const std::filesystem::path& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0)
+        mWatchInodes[wd] = { st.st_dev, st.st_ino };
+}
+
+/**
+ * @brief Check an event against the other events of its read batch by
+ *        inode. Entries of a watched directory are looked up with lstat,
+ *        an entry which is already gone is never a duplicate.
+ */
+bool Inotify::isDuplicateRecord(const inotify_event& event, const std::filesystem::path& path, Event decoded)
+{
+    if (event.len == 0) {
+        const auto inode = mWatchInodes.find(event.wd);
+        return inode != std::end(mWatchInodes) && isDuplicate(inode->second.first, inode->second.second, decoded);
+    }
+
+    struct stat st;
+    return lstat(path.c_str(), &st) == 0 && isDuplicate(st.st_dev, st.st_ino, decoded);
 }
 
 std::filesystem::path
@@ -146,54 +186,56 @@ Inotify::wdToPath(int wd)
  */
 TFileSystemEventPtr Inotify::getNextEvent()
 {
-    int length = 0;
-    char buffer[EVENT_BUF_LEN];
+    char* buffer = _Buffer.data();
 
     // Read Events from fd into buffer
     while (_Queue.empty() && isRunning()) {
-        length = 0;
-        memset(buffer, '\0', sizeof(buffer));
-        while (length <= 0 && !stopped && isRunning()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(mThreadSleep));
-
-            length = read(mInotifyFd, buffer, EVENT_BUF_LEN);
-            if (length == -1) {
-                mError = errno;
-                if (mError != EINTR) {
-                    continue;
-                }
-            }
-        }
+        const ssize_t length = readEvents(mInotifyFd, buffer, _Buffer.size());
+        const std::uint64_t readTime = pipelineClock();
 
         if (isStopped()) {
             return nullptr;
         }
 
-        int i = 0;
+        // a single record can't have a duplicate
+        const bool deduplicate = _Deduplicate && length > static_cast<ssize_t>(EVENT_SIZE + reinterpret_cast<inotify_event*>(buffer)->len);
+        if (deduplicate)
+            beginBatch();
+
+        ssize_t i = 0;
         while (i < length && isRunning()) {
 
             const auto* event = reinterpret_cast<inotify_event*>(&buffer[i]);
             if (!event)
                 return nullptr;
 
-            const auto path = wdToPath(event->wd);
-            if (!isIgnoredOnce(path)) {
-                _Queue.push(std::make_shared<FileSystemEvent>(path,
-                                                              _EventHandler.getInotify(
-                                                                      static_cast<uint32_t>(event->mask))));
+            NotifyCounters::add(_Counters.eventsDecoded);
+            if (event->mask & IN_Q_OVERFLOW)
+                NotifyCounters::add(_Counters.overflows);
+
+            // IN_Q_OVERFLOW and events of removed watches have no known wd
+            const auto found = mDirectorieMap.find(event->wd);
+            // events of a watched directory name the entry, ignoreOnce() takes either
+            const std::filesystem::path path = found == std::end(mDirectorieMap) ? std::filesystem::path()
+                : event->len > 0 ? found->second / event->name : found->second;
+            if (found != std::end(mDirectorieMap) && !(path != found->second && isIgnoredOnce(path)) && !isIgnoredOnce(found->second)) {
+                const Event decoded = _EventHandler.getInotify(static_cast<uint32_t>(event->mask));
+                if (!isFiltered(path, decoded) && !(deduplicate && isDuplicateRecord(*event, path, decoded)))
+                    enqueue(std::make_shared<FileSystemEvent>(path, decoded), readTime);
+            }
+            else {
+                NotifyCounters::add(_Counters.eventsIgnored);
             }
             i += EVENT_SIZE + event->len;
         }
     }
 
-    if (isStopped() || _Queue.empty()) {
-        return nullptr;
-    }
+    return dequeue();
+}
 
-    // Return next event
-    auto event = _Queue.front();
-    _Queue.pop();
-    return event;
+void Inotify::placeBuffers(bool lock)
+{
+    _Buffer.place(lock);
 }
 
 std::uint32_t
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/latency_histogram.h>
+
+#include <algorithm>
+
+namespace notifycpp {
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(std::uint64_t value)
+{
+    _Counts[index(value)].fetch_add(1, std::memory_order_relaxed);
+    _Count.fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t max = _Max.load(std::memory_order_relaxed);
+    while (value > max && !_Max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+std::uint64_t LatencyHistogram::count() const
+{
+    return _Count.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::max() const
+{
+    return _Max.load(std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::percentile(double percentile) const
+{
+    const std::uint64_t total = count();
+    if (total == 0)
+        return 0;
+
+    const auto wanted = std::max<std::uint64_t>(1,
+        static_cast<std::uint64_t>(percentile / 100.0 * static_cast<double>(total) + 0.5));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < _Counts.size(); ++i) {
+        seen += _Counts[i].load(std::memory_order_relaxed);
+        if (seen >= wanted)
+            return std::min(upperBound(i), max());
+    }
+    return max();
+}
+
+void LatencyHistogram::reset()
+{
+    for (auto& count : _Counts)
+        count.store(0, std::memory_order_relaxed);
+    _Count.store(0, std::memory_order_relaxed);
+    _Max.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Values below 2 * SubBuckets are counted exactly, larger ones by
+ * their upper SubBucketBits + 1 bits.
+ */
+std::size_t LatencyHistogram::index(std::uint64_t value)
+{
+    if (value < 2 * SubBuckets)
+        return static_cast<std::size_t>(value);
+
+    const unsigned bits = 64 - static_cast<unsigned>(__builtin_clzll(value));
+    const unsigned shift = bits - SubBucketBits - 1;
+    return shift * SubBuckets + static_cast<std::size_t>(value >> shift);
+}
+
+std::uint64_t LatencyHistogram::upperBound(std::size_t index)
+{
+    if (index < 2 * SubBuckets)
+        return index;
+
+    const std::size_t shift = index / SubBuckets - 1;
+    const std::uint64_t sub = index - shift * SubBuckets;
+    return ((sub + 1) << shift) - 1;
+}
+}
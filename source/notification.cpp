@@ -28,6 +28,16 @@ namespace notifycpp {
 Notification::Notification(Event event, const std::string& path)
     : _Event(event)
     , _Path(path)
+    , _Pid(0)
+{
+}
+
+Notification::Notification(Event event, const FileSystemEvent& fse)
+    : _Event(event)
+    , _Path(fse.getPath())
+    , _Pid(fse.getPid())
+    , _ProcessInfo(fse.getProcessInfo())
+    , _FileDescriptor(fse.getFileDescriptor())
 {
 }
 
@@ -40,4 +50,19 @@ Event Notification::getEvent() const
 {
     return _Event;
 }
+
+pid_t Notification::getPid() const
+{
+    return _Pid;
+}
+
+TProcessInfoPtr Notification::getProcessInfo() const
+{
+    return _ProcessInfo;
+}
+
+TFileDescriptorPtr Notification::getFileDescriptor() const
+{
+    return _FileDescriptor;
+}
 }
@@ -35,16 +35,42 @@
 #include <unistd.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace notifycpp {
 
+namespace {
+    //! upper bound of the pause instructions between two reads of a spin
+    const unsigned int MaxSpinBackoff = 64;
+
+    inline void cpuRelax()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    std::uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+                                              .count());
+    }
+}
+
 Notify::Notify()
     : _Stopped(false)
     , mThreadSleep(250)
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    , _PipelineTiming(std::make_unique<PipelineTiming>())
+#endif
 {
 }
 
@@ -80,10 +106,17 @@ bool Notify::isIgnoredOnce(const std::filesystem::path& p) const
 
 bool Notify::isIgnored(const std::filesystem::path& p) const
 {
+    if (_IgnorePatterns && _IgnorePatterns->matches(p.native()))
+        return true;
     return std::any_of(std::begin(_Ignored), std::end(_Ignored),
         [&p](const std::filesystem::path& ip) { return p == ip; });
 }
 
+void Notify::setIgnorePatterns(std::shared_ptr<const GlobSet> patterns)
+{
+    _IgnorePatterns = std::move(patterns);
+}
+
 std::string Notify::getFilePath(int fd) const
 {
     char buffer[PATH_MAX];
@@ -123,19 +156,281 @@ bool Notify::checkWatchDirectory(const FileSystemEvent& fse) const
     return !isIgnored(fse.getPath());
 }
 
+namespace {
+    // Events which change the entries of a directory
+    const Event TreeIndexEvents = Event::create | Event::delete_sub | Event::move;
+}
+
 void Notify::watchPathRecursively(const FileSystemEvent& fse)
 {
     if (!checkWatchDirectory(fse))
         return;
 
-    for(auto& p: std::filesystem::recursive_directory_iterator(fse.getPath())) {
-        const FileSystemEvent tmp_fse(p);
-        if (checkWatchFile(tmp_fse)) {
+    if (_TreeIndex) {
+        _TreeIndex->update(fse.getPath());
+        watchDirectory({ fse.getPath(), TreeIndexEvents });
+    }
+
+    for (auto it = std::filesystem::recursive_directory_iterator(fse.getPath()); it != std::filesystem::recursive_directory_iterator(); ++it) {
+        const auto& p = *it;
+        NotifyCounters::add(_Counters.crawledPaths);
+        // nothing below an ignored directory is crawled, indexed or watched
+        if (_IgnorePatterns && _IgnorePatterns->matches(p.path().native())) {
+            it.disable_recursion_pending();
+            continue;
+        }
+        if (_TreeIndex)
+            _TreeIndex->update(p);
+
+        const auto status = p.symlink_status();
+        if (std::filesystem::is_directory(status)) {
+            if (_TreeIndex && !isIgnored(p))
+                watchDirectory({ p, TreeIndexEvents });
+            continue;
+        }
+
+        const FileSystemEvent tmp_fse(p, fse.getEvent());
+        if (std::filesystem::is_regular_file(status) && checkWatchFile(tmp_fse)) {
             watchFile(tmp_fse);
         }
     }
 }
 
+void Notify::setTreeIndex(std::shared_ptr<TreeIndex> index)
+{
+    _TreeIndex = std::move(index);
+}
+
+std::shared_ptr<TreeIndex> Notify::getTreeIndex() const
+{
+    return _TreeIndex;
+}
+
+void Notify::setFilter(TEventFilterPtr filter)
+{
+    _Filter = std::move(filter);
+}
+
+TEventFilterPtr Notify::getFilter() const
+{
+    return _Filter;
+}
+
+void Notify::placeBuffers(bool)
+{
+}
+
+void Notify::setDeduplication(bool deduplicate)
+{
+    _Deduplicate = deduplicate;
+    _BatchKeys.clear();
+}
+
+void Notify::setSpinBudget(std::chrono::nanoseconds budget)
+{
+    _SpinBudget = budget;
+}
+
+std::chrono::nanoseconds Notify::getSpinBudget() const
+{
+    return _SpinBudget;
+}
+
+void Notify::setWorkerThreadOptions(const ThreadOptions& options)
+{
+    _WorkerThreadOptions = options;
+}
+
+const ThreadOptions& Notify::getWorkerThreadOptions() const
+{
+    return _WorkerThreadOptions;
+}
+
+/**
+ * @brief Check a decoded event against the ignore patterns and the
+ *        filter before it is allocated
+ *
+ * A rejected event is counted as ignored. It is still applied to the
+ * tree index, which would go stale otherwise.
+ *
+ * @return true if the event has to be dropped
+ */
+bool Notify::isFiltered(const std::filesystem::path& path, Event event)
+{
+    const bool ignored = _IgnorePatterns && _IgnorePatterns->matches(path.native());
+    if (!ignored && (!_Filter || _Filter->matches(path.native(), event)))
+        return false;
+
+    NotifyCounters::add(_Counters.eventsIgnored);
+    if (_TreeIndex && _TreeIndex->apply({ path, event }))
+        indexDirectory(path);
+    return true;
+}
+
+void Notify::watchTreeIndex(Event event, std::size_t threads)
+{
+    if (!_TreeIndex)
+        throw std::invalid_argument("Can´t watch tree index! No tree index attached.");
+
+    const auto directories = _TreeIndex->getDirectories();
+    for (const auto& directory : directories) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(directory, ec) && !isIgnored(directory))
+            watchDirectory({ directory, event | TreeIndexEvents });
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, std::max<std::size_t>(directories.size(), 1));
+
+    // The index is only read while diffing, events are queued afterwards
+    std::vector<std::vector<FileSystemEvent>> changes(threads);
+    std::vector<std::thread> workers;
+    for (std::size_t worker = 0; worker < threads; ++worker) {
+        workers.emplace_back([&, worker]() {
+            tryApplyThreadOptions(_WorkerThreadOptions);
+            for (std::size_t i = worker; i < directories.size(); i += threads) {
+                auto events = _TreeIndex->diffDirectory(directories[i]);
+                changes[worker].insert(std::end(changes[worker]), std::begin(events), std::end(events));
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    const auto readTime = pipelineClock();
+    for (const auto& events : changes) {
+        for (const auto& fse : events) {
+            if (!isIgnored(fse.getPath()) && (!_Filter || _Filter->matches(fse)))
+                enqueue(std::make_shared<FileSystemEvent>(fse), readTime);
+        }
+    }
+}
+
+/**
+ * @brief Index and watch a directory which appeared below a watched
+ *        one. The directory is watched before it is crawled, so no
+ *        entry created in between is missed.
+ */
+void Notify::indexDirectory(const std::filesystem::path& path)
+{
+    try {
+        watchDirectory({ path, TreeIndexEvents });
+        _TreeIndex->crawl(path);
+
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(path, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec) && !it->is_symlink(ec))
+                watchDirectory({ it->path(), TreeIndexEvents });
+        }
+    }
+    catch (const std::exception&) {
+        // the directory is already gone again, its delete event follows
+    }
+}
+
+/**
+ * @brief Read the next batch of kernel records from a non-blocking fd
+ *
+ * Within the spin budget the fd is read in a loop, backing off with an
+ * exponentially growing number of pause instructions. Afterwards poll(2)
+ * blocks for up to mThreadSleep, so stop() is noticed in time.
+ *
+ * @return bytes read, 0 if nothing arrived or the backend stopped
+ */
+ssize_t Notify::readEvents(int fd, char* buffer, std::size_t size)
+{
+    if (_SpinBudget.count() > 0) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto deadline = start + _SpinBudget;
+        unsigned int backoff = 1;
+        while (isRunning()) {
+            const ssize_t length = read(fd, buffer, size);
+            NotifyCounters::add(_Counters.syscalls);
+            NotifyCounters::add(_Counters.spinReads);
+            if (length > 0) {
+                NotifyCounters::add(_Counters.bytesRead, static_cast<std::uint64_t>(length));
+                NotifyCounters::add(_Counters.spinHits);
+                NotifyCounters::add(_Counters.spinNanoseconds, nanosecondsSince(start));
+                beginDecodeSample();
+                return length;
+            }
+            if ((length == -1 && errno != EAGAIN && errno != EINTR) || std::chrono::steady_clock::now() >= deadline)
+                break;
+
+            for (unsigned int i = 0; i < backoff; ++i)
+                cpuRelax();
+            backoff = std::min(backoff * 2, MaxSpinBackoff);
+        }
+        NotifyCounters::add(_Counters.spinNanoseconds, nanosecondsSince(start));
+    }
+
+    if (isStopped())
+        return 0;
+
+    pollfd pfd { fd, POLLIN, 0 };
+    NotifyCounters::add(_Counters.syscalls);
+    NotifyCounters::add(_Counters.blockingWaits);
+    if (poll(&pfd, 1, mThreadSleep) < 0) {
+        if (errno == EINTR)
+            return 0;
+        std::stringstream errorStream;
+        errorStream << "Couldn't poll(): " << strerror(errno) << ".";
+        throw std::runtime_error(errorStream.str());
+    }
+    if (!(pfd.revents & POLLIN))
+        return 0;
+
+    const ssize_t length = read(fd, buffer, size);
+    NotifyCounters::add(_Counters.syscalls);
+    if (length <= 0)
+        return 0;
+    NotifyCounters::add(_Counters.bytesRead, static_cast<std::uint64_t>(length));
+    beginDecodeSample();
+    return length;
+}
+
+void Notify::setProfiler(std::shared_ptr<PerfProfiler> profiler)
+{
+    _Profiler = std::move(profiler);
+    _Decoding = false;
+}
+
+/**
+ * @brief Start sampling the decode of a batch which was just read. A
+ *        batch that queued no event is closed by the next read.
+ */
+void Notify::beginDecodeSample()
+{
+    endDecodeSample();
+    _Decoding = _Profiler && _Profiler->open() && _Profiler->sample(_DecodeStart);
+}
+
+void Notify::endDecodeSample()
+{
+    if (!_Decoding)
+        return;
+    _Decoding = false;
+
+    HardwareCounters done;
+    if (_Profiler->sample(done))
+        _Profiler->recordDecode(_DecodeStart, done);
+}
+
+void Notify::beginBatch()
+{
+    _BatchKeys.clear();
+}
+
+bool Notify::isDuplicate(dev_t dev, ino_t ino, Event event)
+{
+    if (_BatchKeys.insert({ dev, ino, event }).second)
+        return false;
+    NotifyCounters::add(_Counters.eventsDeduplicated);
+    return true;
+}
+
 /**
  * @return true if Notify has stopped, otherwise false
  */
@@ -152,4 +447,67 @@ bool Notify::isRunning() const
     return !_Stopped;
 }
 
+
+/**
+ * @brief Queue a decoded event
+ *
+ * @param readTime pipelineClock() after the read() the event was decoded from
+ */
+void Notify::enqueue(TFileSystemEventPtr fse, std::uint64_t readTime)
+{
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    PipelineTimestamps timestamps;
+    timestamps.read = readTime;
+    timestamps.decoded = pipelineClock();
+    // pushing is O(1), decode and enqueue share one clock read
+    timestamps.enqueued = timestamps.decoded;
+    fse->setTimestamps(timestamps);
+#else
+    (void)readTime;
+#endif
+    _Queue.push(std::move(fse));
+    NotifyCounters::raise(_Counters.queueHighWatermark, _Queue.size());
+}
+
+NotifyStats Notify::getStats() const
+{
+    return _Counters.snapshot();
+}
+
+void Notify::countObserverInvocations(std::uint64_t count)
+{
+    NotifyCounters::add(_Counters.observerInvocations, count);
+}
+
+/**
+ * @brief Take the next queued event, nullptr if stopped or empty
+ */
+TFileSystemEventPtr Notify::dequeue()
+{
+    endDecodeSample();
+    if (isStopped() || _Queue.empty()) {
+        return nullptr;
+    }
+
+    auto event = _Queue.front();
+    _Queue.pop();
+
+    if (_TreeIndex && _TreeIndex->apply(*event))
+        indexDirectory(event->getPath());
+    return event;
+}
+
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+const PipelineTiming* Notify::getPipelineTiming() const
+{
+    return _PipelineTiming.get();
+}
+
+void Notify::recordPipelineTiming(const FileSystemEvent& fse, std::uint64_t dispatched)
+{
+    PipelineTimestamps timestamps = fse.getTimestamps();
+    timestamps.dispatched = dispatched;
+    _PipelineTiming->record(timestamps, pipelineClock());
+}
+#endif
 }
@@ -25,6 +25,8 @@
 #include <notify-cpp/inotify.h>
 #include <notify-cpp/notify_controller.h>
 
+#include <algorithm>
+
 namespace notifycpp {
 
 FanotifyController::FanotifyController()
@@ -32,9 +34,32 @@ FanotifyController::FanotifyController()
 {
 }
 
-NotifyController& FanotifyController::watchMountPoint(const std::filesystem::path& p)
+FanotifyController::FanotifyController(const FanotifyOptions& options)
+    : NotifyController(new Fanotify(options))
 {
-    static_cast<Fanotify*>(_Notify)->watchMountPoint(p);
+}
+
+NotifyController& FanotifyController::watchMountPoint(const FileSystemEvent& fse)
+{
+    static_cast<Fanotify*>(_Notify.get())->watchMountPoint(fse);
+    return *this;
+}
+
+NotifyController& FanotifyController::onPermission(PermissionHandler handler)
+{
+    static_cast<Fanotify*>(_Notify.get())->setPermissionHandler(std::move(handler));
+    return *this;
+}
+
+NotifyController& FanotifyController::setVerdictWorkers(std::size_t count)
+{
+    static_cast<Fanotify*>(_Notify.get())->setVerdictWorkers(count);
+    return *this;
+}
+
+NotifyController& FanotifyController::setVerdictCacheSize(std::size_t size)
+{
+    static_cast<Fanotify*>(_Notify.get())->setVerdictCacheSize(size);
     return *this;
 }
 
@@ -43,6 +68,21 @@ InotifyController::InotifyController()
 {
 }
 
+FakeNotifyController::FakeNotifyController()
+    : NotifyController(new FakeNotify)
+{
+}
+
+FakeNotify& FakeNotifyController::getFakeNotify()
+{
+    return *static_cast<FakeNotify*>(_Notify.get());
+}
+
+ReplayNotifyController::ReplayNotifyController(const EventJournal& journal, const ReplayOptions& options)
+    : NotifyController(new ReplayNotify(journal, options))
+{
+}
+
 NotifyController::NotifyController(Notify* n)
     : _Notify(n)
 {
@@ -58,7 +98,7 @@ NotifyController::watchFile(const FileSystemEvent& fse)
 NotifyController&
 NotifyController::watchDirectory(const FileSystemEvent& fse)
 {
-    static_cast<Inotify*>(_Notify)->watchDirectory(fse);
+    _Notify->watchDirectory(fse);
     return *this;
 }
 
@@ -80,6 +120,12 @@ NotifyController& NotifyController::ignore(const std::filesystem::path& p)
     _Notify->ignore(p);
     return *this;
 }
+NotifyController& NotifyController::ignorePatterns(const std::vector<std::string>& patterns)
+{
+    _Notify->setIgnorePatterns(patterns.empty() ? nullptr : std::make_shared<GlobSet>(patterns));
+    return *this;
+}
+
 NotifyController& NotifyController::ignoreOnce(const std::filesystem::path& p)
 {
     _Notify->ignoreOnce(p);
@@ -88,14 +134,21 @@ NotifyController& NotifyController::ignoreOnce(const std::filesystem::path& p)
 
 NotifyController& NotifyController::onEvent(Event event, EventObserver eventObserver)
 {
-    mEventObserver[event] = eventObserver;
+    addObserver(event, std::move(eventObserver));
     return *this;
 }
 
 NotifyController& NotifyController::onEvents(std::set<Event> events, EventObserver eventObserver)
 {
     for (auto event : events)
-        mEventObserver[event] = eventObserver;
+        addObserver(event, eventObserver);
+    return *this;
+}
+
+NotifyController&
+NotifyController::onPath(const std::filesystem::path& prefix, Event event, EventObserver eventObserver)
+{
+    mPathRouter.add(prefix, event, std::move(eventObserver));
     return *this;
 }
 
@@ -106,34 +159,217 @@ NotifyController::onUnexpectedEvent(EventObserver eventObserver)
     return *this;
 }
 
+NotifyController& NotifyController::setFilter(const std::string& expression)
+{
+    _Notify->setFilter(expression.empty() ? nullptr : std::make_shared<EventFilter>(expression));
+    return *this;
+}
+
+TSubscriberPtr NotifyController::subscribe(const SubscriberOptions& options, EventObserver eventObserver)
+{
+    if (!mPublisher)
+        mPublisher = std::make_shared<EventPublisher>();
+
+    const bool inherit = options.thread.cpus.empty() && options.thread.policy == SchedulingPolicy::inherit;
+    if (!inherit)
+        return mPublisher->subscribe(options, std::move(eventObserver));
+
+    SubscriberOptions withWorkerOptions = options;
+    withWorkerOptions.thread = mThreadOptions.workers;
+    return mPublisher->subscribe(withWorkerOptions, std::move(eventObserver));
+}
+
+NotifyController& NotifyController::unsubscribe(const TSubscriberPtr& subscriber)
+{
+    if (mPublisher)
+        mPublisher->unsubscribe(subscriber);
+    return *this;
+}
+
 void NotifyController::runOnce()
 {
+    if (mPlaceReader) {
+        mPlaceReader = false;
+        applyThreadOptions(mThreadOptions.reader);
+        _Notify->placeBuffers(mThreadOptions.lockBuffers);
+    }
+
+    // decoding is sampled by the backend, without the wait for the kernel
     auto fileSystemEvent = _Notify->getNextEvent();
     if (!fileSystemEvent) {
         return;
     }
+    const auto dispatched = pipelineClock();
 
-    const Event event = fileSystemEvent->getEvent();
-    const auto observers = findObserver(event);
+    PerfProfiler* profiler = mProfiler && mProfiler->open() ? mProfiler.get() : nullptr;
+    HardwareCounters start;
+    if (profiler && !profiler->sample(start))
+        profiler = nullptr;
 
-    if (observers.empty()) {
-        if (mUnexpectedEventObserver) {
-            mUnexpectedEventObserver({event, fileSystemEvent->getPath()});
-        }
+    if (mJournal)
+        mJournal->append(*fileSystemEvent);
+
+    if (mPublisher)
+        mPublisher->publish(fileSystemEvent);
+
+    dispatch(*fileSystemEvent);
+
+    _Notify->recordPipelineTiming(*fileSystemEvent, dispatched);
+
+    HardwareCounters done;
+    if (profiler && profiler->sample(done))
+        profiler->recordDispatch(start, done);
+}
+
+NotifyStats NotifyController::getStats() const
+{
+    NotifyStats stats = _Notify->getStats();
+    if (mProfiler)
+        mProfiler->addTo(stats);
+    return stats;
+}
+
+NotifyController& NotifyController::enableProfiling()
+{
+    if (!mProfiler) {
+        mProfiler = std::make_shared<PerfProfiler>();
+        _Notify->setProfiler(mProfiler);
     }
-    else {
-        for (const auto& observerEvent : observers) {
-            /* handle observed processes */
-            auto eventObserver = observerEvent.second;
-            eventObserver({observerEvent.first, fileSystemEvent->getPath()});
-        }
+    return *this;
+}
+
+const PipelineTiming* NotifyController::getPipelineTiming() const
+{
+    return _Notify->getPipelineTiming();
+}
+
+NotifyController& NotifyController::deduplicate(bool enabled)
+{
+    _Notify->setDeduplication(enabled);
+    return *this;
+}
+
+NotifyController& NotifyController::setSpinBudget(std::chrono::nanoseconds budget)
+{
+    _Notify->setSpinBudget(budget);
+    return *this;
+}
+
+NotifyController& NotifyController::setThreadOptions(const ControllerThreadOptions& options)
+{
+    mThreadOptions = options;
+    mPlaceReader = true;
+    _Notify->setWorkerThreadOptions(options.workers);
+    return *this;
+}
+
+/**
+ * @brief Call the observers of an event through the dispatch table
+ */
+void NotifyController::dispatch(const FileSystemEvent& fileSystemEvent)
+{
+    if (mDispatchDirty)
+        compileObservers();
+
+    const Event event = fileSystemEvent.getEvent();
+    const auto mask = static_cast<std::size_t>(event) & (EventMaskSpace - 1);
+    const auto begin = mDispatchOffset[mask];
+    const auto end = mDispatchOffset[mask + 1];
+
+    for (auto i = begin; i < end; ++i) {
+        /* handle observed processes */
+        const auto& observerEvent = mEventObserver[mDispatchIndex[i]];
+        observerEvent.second({observerEvent.first, fileSystemEvent});
     }
+    std::size_t called = end - begin;
+
+    if (!mPathRouter.empty())
+        called += mPathRouter.dispatch(fileSystemEvent);
+
+    if (called == 0 && mUnexpectedEventObserver) {
+        mUnexpectedEventObserver({event, fileSystemEvent});
+        called = 1;
+    }
+    if (called != 0)
+        _Notify->countObserverInvocations(called);
+}
+
+NotifyController& NotifyController::setTreeIndex(std::shared_ptr<TreeIndex> index)
+{
+    _Notify->setTreeIndex(std::move(index));
+    return *this;
+}
+
+std::shared_ptr<TreeIndex> NotifyController::getTreeIndex() const
+{
+    return _Notify->getTreeIndex();
+}
+
+NotifyController& NotifyController::restoreSnapshot(const std::filesystem::path& snapshot, Event event, std::size_t threads)
+{
+    auto index = _Notify->getTreeIndex();
+    if (!index) {
+        index = std::make_shared<TreeIndex>();
+        _Notify->setTreeIndex(index);
+    }
+    index->load(snapshot);
+    _Notify->watchTreeIndex(event, threads);
+    return *this;
+}
+
+NotifyController& NotifyController::saveSnapshot(const std::filesystem::path& snapshot)
+{
+    if (const auto index = _Notify->getTreeIndex())
+        index->save(snapshot);
+    return *this;
+}
+
+NotifyController& NotifyController::setSnapshotInterval(const std::filesystem::path& snapshot, std::chrono::seconds interval)
+{
+    mSnapshotPath = snapshot;
+    mSnapshotInterval = interval;
+    return *this;
+}
+
+NotifyController& NotifyController::setJournal(std::shared_ptr<EventJournal> journal)
+{
+    mJournal = std::move(journal);
+    return *this;
+}
+
+/**
+ * @brief Dispatch journaled events to the observers without waiting for
+ *        the backend. Replayed events are not journaled again.
+ *
+ * @return sequence of the last replayed event, 0 if none
+ */
+std::uint64_t NotifyController::replay(const EventJournal& journal, std::uint64_t from)
+{
+    return journal.replay(from, [this](const JournalRecord& record) {
+        if (mPublisher)
+            mPublisher->publish(std::make_shared<FileSystemEvent>(record.event));
+        dispatch(record.event);
+    });
 }
 
 void NotifyController::run()
 {
-    while (!_Notify->hasStopped())
+    if (mSnapshotPath.empty()) {
+        while (!_Notify->hasStopped())
+            runOnce();
+        return;
+    }
+
+    auto nextSnapshot = std::chrono::steady_clock::now() + mSnapshotInterval;
+    while (!_Notify->hasStopped()) {
         runOnce();
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= nextSnapshot) {
+            saveSnapshot(mSnapshotPath);
+            nextSnapshot = now + mSnapshotInterval;
+        }
+    }
+    saveSnapshot(mSnapshotPath);
 }
 
 void NotifyController::stop()
@@ -141,13 +377,44 @@ void NotifyController::stop()
     _Notify->stop();
 }
 
-std::vector<std::pair<Event, EventObserver>>
-NotifyController::findObserver(Event e) const
+/**
+ * @brief Register an observer, an observer for the same Event is replaced.
+ */
+void NotifyController::addObserver(Event event, EventObserver eventObserver)
+{
+    auto it = std::lower_bound(std::begin(mEventObserver), std::end(mEventObserver), event,
+        [](const std::pair<Event, EventObserver>& observer, Event e) { return observer.first < e; });
+
+    if (it != std::end(mEventObserver) && it->first == event)
+        it->second = std::move(eventObserver);
+    else
+        mEventObserver.emplace(it, event, std::move(eventObserver));
+
+    mDispatchDirty = true;
+}
+
+/**
+ * @brief Precompute the observers of every possible event mask. An
+ *        observer matches an event if it was registered for all bits
+ *        of the event.
+ */
+void NotifyController::compileObservers()
 {
-    std::vector<std::pair<Event, EventObserver>> observers;
-    for (auto const& event2Observer : mEventObserver)
-        if ((event2Observer.first & e) == e)
-            observers.emplace_back(event2Observer.first, event2Observer.second);
-    return observers;
+    // one observer per Event, the index can't wrap
+    static_assert(EventMaskSpace <= UINT32_MAX, "observer indices are 32 bit");
+
+    mDispatchOffset.assign(EventMaskSpace + 1, 0);
+    mDispatchIndex.clear();
+
+    for (std::size_t mask = 0; mask < EventMaskSpace; ++mask) {
+        mDispatchOffset[mask] = static_cast<std::uint32_t>(mDispatchIndex.size());
+        const auto e = static_cast<Event>(mask);
+        for (std::size_t i = 0; i < mEventObserver.size(); ++i)
+            if ((mEventObserver[i].first & e) == e)
+                mDispatchIndex.push_back(static_cast<std::uint32_t>(i));
+    }
+    mDispatchOffset[EventMaskSpace] = static_cast<std::uint32_t>(mDispatchIndex.size());
+
+    mDispatchDirty = false;
 }
 }
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/notify_stats.h>
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace notifycpp {
+
+namespace {
+    void writeMetric(std::ostream& out, const char* name, const char* type, const char* help, std::uint64_t value)
+    {
+        out << "# HELP " << name << ' ' << help << '\n'
+            << "# TYPE " << name << ' ' << type << '\n'
+            << name << ' ' << value << '\n';
+    }
+
+    void writeStageMetric(std::ostream& out, const char* name, const char* help,
+        std::uint64_t decode, std::uint64_t dispatch)
+    {
+        out << "# HELP " << name << ' ' << help << '\n'
+            << "# TYPE " << name << " counter\n"
+            << name << "{stage=\"decode\"} " << decode << '\n'
+            << name << "{stage=\"dispatch\"} " << dispatch << '\n';
+    }
+}
+
+NotifyStats NotifyCounters::snapshot() const
+{
+    NotifyStats stats;
+    stats.syscalls = syscalls.load(std::memory_order_relaxed);
+    stats.bytesRead = bytesRead.load(std::memory_order_relaxed);
+    stats.eventsDecoded = eventsDecoded.load(std::memory_order_relaxed);
+    stats.eventsIgnored = eventsIgnored.load(std::memory_order_relaxed);
+    stats.eventsDeduplicated = eventsDeduplicated.load(std::memory_order_relaxed);
+    stats.queueHighWatermark = queueHighWatermark.load(std::memory_order_relaxed);
+    stats.overflows = overflows.load(std::memory_order_relaxed);
+    stats.observerInvocations = observerInvocations.load(std::memory_order_relaxed);
+    stats.activeWatches = activeWatches.load(std::memory_order_relaxed);
+    stats.crawledPaths = crawledPaths.load(std::memory_order_relaxed);
+    stats.permissionErrors = permissionErrors.load(std::memory_order_relaxed);
+    stats.spinReads = spinReads.load(std::memory_order_relaxed);
+    stats.spinHits = spinHits.load(std::memory_order_relaxed);
+    stats.spinNanoseconds = spinNanoseconds.load(std::memory_order_relaxed);
+    stats.blockingWaits = blockingWaits.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void writePrometheus(std::ostream& out, const NotifyStats& stats)
+{
+    writeMetric(out, "notifycpp_syscalls_total", "counter",
+        "read() and poll() calls of the event loop.", stats.syscalls);
+    writeMetric(out, "notifycpp_read_bytes_total", "counter",
+        "Bytes read from the notification descriptor.", stats.bytesRead);
+    writeMetric(out, "notifycpp_events_decoded_total", "counter",
+        "Kernel event records decoded.", stats.eventsDecoded);
+    writeMetric(out, "notifycpp_events_ignored_total", "counter",
+        "Kernel event records dropped before queueing.", stats.eventsIgnored);
+    writeMetric(out, "notifycpp_events_deduplicated_total", "counter",
+        "Events dropped as duplicates within a read batch.", stats.eventsDeduplicated);
+    writeMetric(out, "notifycpp_queue_depth_high_watermark", "gauge",
+        "Highest number of queued events.", stats.queueHighWatermark);
+    writeMetric(out, "notifycpp_queue_overflows_total", "counter",
+        "Kernel queue overflows, events were lost.", stats.overflows);
+    writeMetric(out, "notifycpp_observer_invocations_total", "counter",
+        "Observer calls.", stats.observerInvocations);
+    writeMetric(out, "notifycpp_watches", "gauge",
+        "Active watches or marks.", stats.activeWatches);
+    writeMetric(out, "notifycpp_crawled_paths_total", "counter",
+        "Paths visited by recursive watches.", stats.crawledPaths);
+    writeMetric(out, "notifycpp_permission_errors_total", "counter",
+        "Permission handlers which threw and verdicts which couldn't be written.", stats.permissionErrors);
+    writeMetric(out, "notifycpp_spin_reads_total", "counter",
+        "Reads while busy-polling.", stats.spinReads);
+    writeMetric(out, "notifycpp_spin_hits_total", "counter",
+        "Busy-polls which found events.", stats.spinHits);
+    writeMetric(out, "notifycpp_spin_nanoseconds_total", "counter",
+        "Time spent busy-polling.", stats.spinNanoseconds);
+    writeMetric(out, "notifycpp_blocking_waits_total", "counter",
+        "Blocking poll() calls of the event loop.", stats.blockingWaits);
+
+    if (!stats.profiling)
+        return;
+
+    writeMetric(out, "notifycpp_profiled_events_total", "counter",
+        "Events sampled with hardware counters.", stats.profiledEvents);
+    writeStageMetric(out, "notifycpp_cpu_cycles_total", "CPU cycles of the controller thread.",
+        stats.decodeCounters.cycles, stats.dispatchCounters.cycles);
+    writeStageMetric(out, "notifycpp_instructions_total", "Instructions of the controller thread.",
+        stats.decodeCounters.instructions, stats.dispatchCounters.instructions);
+    writeStageMetric(out, "notifycpp_cache_misses_total", "Cache misses of the controller thread.",
+        stats.decodeCounters.cacheMisses, stats.dispatchCounters.cacheMisses);
+}
+
+void writePrometheus(int fd, const NotifyStats& stats)
+{
+    std::ostringstream out;
+    writePrometheus(out, stats);
+    const std::string text = out.str();
+
+    std::size_t written = 0;
+    while (written < text.size()) {
+        const ssize_t result = write(fd, text.data() + written, text.size() - written);
+        if (result < 0) {
+            if (errno == EINTR)
+                continue;
+            std::stringstream errorStream;
+            errorStream << "Couldn't write statistics: " << strerror(errno) << ".";
+            throw std::runtime_error(errorStream.str());
+        }
+        written += static_cast<std::size_t>(result);
+    }
+}
+
+void writePrometheus(const std::filesystem::path& path, const NotifyStats& stats)
+{
+    std::filesystem::path tmp(path);
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        writePrometheus(out, stats);
+        if (!out) {
+            std::stringstream errorStream;
+            errorStream << "Couldn't write statistics to " << tmp << ".";
+            throw std::runtime_error(errorStream.str());
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+}
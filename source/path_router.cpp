@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/path_router.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace notifycpp {
+
+namespace {
+    const std::uint32_t NoNode = 0;
+
+    /**
+     * @brief Call f for every component of a path, empty components of
+     *        repeated or trailing separators are skipped
+     * @return false if f stopped the walk
+     */
+    template <typename F>
+    bool forEachComponent(std::string_view path, F f)
+    {
+        std::size_t begin = 0;
+        while (begin < path.size()) {
+            auto end = path.find('/', begin);
+            if (end == std::string_view::npos)
+                end = path.size();
+            if (end > begin && !f(path.substr(begin, end - begin)))
+                return false;
+            begin = end + 1;
+        }
+        return true;
+    }
+
+    using Child = std::pair<std::string, std::uint32_t>;
+
+    bool lessComponent(const Child& child, std::string_view component)
+    {
+        return std::string_view(child.first) < component;
+    }
+}
+
+PathRouter::PathRouter()
+    : _Nodes(1)
+{
+}
+
+void PathRouter::add(const std::filesystem::path& prefix, Event event, EventObserver observer)
+{
+    // the walk skips the leading separator, "src" and "/src" would share a node
+    if (!prefix.is_absolute())
+        throw std::invalid_argument("Path route prefix must be absolute: " + prefix.string());
+
+    std::uint32_t node = 0;
+    forEachComponent(prefix.native(), [this, &node](std::string_view component) {
+        auto& children = _Nodes[node].children;
+        auto it = std::lower_bound(std::begin(children), std::end(children), component, lessComponent);
+        if (it != std::end(children) && it->first == component) {
+            node = it->second;
+            return true;
+        }
+
+        const auto child = static_cast<std::uint32_t>(_Nodes.size());
+        children.insert(it, { std::string(component), child });
+        // children lives in _Nodes, insert before growing it
+        _Nodes.emplace_back();
+        node = child;
+        return true;
+    });
+
+    _Nodes[node].routes.push_back(static_cast<std::uint32_t>(_Routes.size()));
+    _Routes.emplace_back(event, std::move(observer));
+}
+
+std::uint32_t PathRouter::findChild(std::uint32_t node, std::string_view component) const
+{
+    const auto& children = _Nodes[node].children;
+    const auto it = std::lower_bound(std::begin(children), std::end(children), component, lessComponent);
+    return it != std::end(children) && it->first == component ? it->second : NoNode;
+}
+
+std::size_t PathRouter::dispatch(const FileSystemEvent& fse) const
+{
+    const Event event = fse.getEvent();
+    const auto& path = fse.getPath();
+    std::size_t called = 0;
+    if (!path.is_absolute())
+        return called;
+
+    const auto callRoutes = [&](std::uint32_t node) {
+        for (const auto route : _Nodes[node].routes) {
+            const auto& observer = _Routes[route];
+            if ((observer.first & event) == event) {
+                observer.second({ observer.first, fse });
+                ++called;
+            }
+        }
+    };
+
+    std::uint32_t node = 0;
+    callRoutes(node);
+    forEachComponent(path.native(), [&](std::string_view component) {
+        node = findChild(node, component);
+        if (node == NoNode)
+            return false;
+        callRoutes(node);
+        return true;
+    });
+    return called;
+}
+
+bool PathRouter::empty() const
+{
+    return _Routes.empty();
+}
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/perf_profiler.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace notifycpp {
+
+namespace {
+    constexpr std::uint64_t Configs[3] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    // open() is called for every event, the tid is looked up once per thread
+    pid_t currentThread()
+    {
+        static thread_local const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+        return tid;
+    }
+}
+
+PerfProfiler::~PerfProfiler()
+{
+    close();
+}
+
+bool PerfProfiler::open()
+{
+    if (_Open.load(std::memory_order_acquire))
+        return _Tid == currentThread();
+    if (_Failed)
+        return false;
+
+    if (!openGroup(false) && !openGroup(true)) {
+        _Failed = true;
+        return false;
+    }
+
+    _Tid = currentThread();
+    ioctl(_Fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_Fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    _Open.store(true, std::memory_order_release);
+    return true;
+}
+
+int PerfProfiler::openCounter(std::uint64_t config, int groupFd, bool excludeKernel) const
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = excludeKernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // pid 0 and cpu -1: the calling thread on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, PERF_FLAG_FD_CLOEXEC));
+}
+
+bool PerfProfiler::openGroup(bool excludeKernel)
+{
+    for (std::size_t i = 0; i < 3; ++i) {
+        _Fds[i] = openCounter(Configs[i], i == 0 ? -1 : _Fds[0], excludeKernel);
+        if (_Fds[i] < 0) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void PerfProfiler::close()
+{
+    for (auto& fd : _Fds) {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+}
+
+bool PerfProfiler::sample(HardwareCounters& counters) const
+{
+    struct {
+        std::uint64_t nr;
+        std::uint64_t timeEnabled;
+        std::uint64_t timeRunning;
+        std::uint64_t values[3];
+    } group;
+
+    if (read(_Fds[0], &group, sizeof(group)) != static_cast<ssize_t>(sizeof(group)) || group.nr != 3
+        || group.timeRunning == 0)
+        return false;
+
+    // the group only counted for timeRunning of timeEnabled if the PMU was multiplexed
+    const double scale = static_cast<double>(group.timeEnabled) / static_cast<double>(group.timeRunning);
+    counters.cycles = static_cast<std::uint64_t>(static_cast<double>(group.values[0]) * scale);
+    counters.instructions = static_cast<std::uint64_t>(static_cast<double>(group.values[1]) * scale);
+    counters.cacheMisses = static_cast<std::uint64_t>(static_cast<double>(group.values[2]) * scale);
+    return true;
+}
+
+namespace {
+    // scaled counts are estimates, a later sample may come out lower
+    std::uint64_t difference(std::uint64_t start, std::uint64_t done)
+    {
+        return done > start ? done - start : 0;
+    }
+}
+
+void PerfProfiler::recordDecode(const HardwareCounters& start, const HardwareCounters& done)
+{
+    _DecodeCounters[0].fetch_add(difference(start.cycles, done.cycles), std::memory_order_relaxed);
+    _DecodeCounters[1].fetch_add(difference(start.instructions, done.instructions), std::memory_order_relaxed);
+    _DecodeCounters[2].fetch_add(difference(start.cacheMisses, done.cacheMisses), std::memory_order_relaxed);
+}
+
+void PerfProfiler::recordDispatch(const HardwareCounters& start, const HardwareCounters& done)
+{
+    _Events.fetch_add(1, std::memory_order_relaxed);
+
+    _DispatchCounters[0].fetch_add(difference(start.cycles, done.cycles), std::memory_order_relaxed);
+    _DispatchCounters[1].fetch_add(difference(start.instructions, done.instructions), std::memory_order_relaxed);
+    _DispatchCounters[2].fetch_add(difference(start.cacheMisses, done.cacheMisses), std::memory_order_relaxed);
+}
+
+void PerfProfiler::addTo(NotifyStats& stats) const
+{
+    stats.profiling = _Open.load(std::memory_order_relaxed);
+    stats.profiledEvents = _Events.load(std::memory_order_relaxed);
+
+    stats.decodeCounters.cycles = _DecodeCounters[0].load(std::memory_order_relaxed);
+    stats.decodeCounters.instructions = _DecodeCounters[1].load(std::memory_order_relaxed);
+    stats.decodeCounters.cacheMisses = _DecodeCounters[2].load(std::memory_order_relaxed);
+
+    stats.dispatchCounters.cycles = _DispatchCounters[0].load(std::memory_order_relaxed);
+    stats.dispatchCounters.instructions = _DispatchCounters[1].load(std::memory_order_relaxed);
+    stats.dispatchCounters.cacheMisses = _DispatchCounters[2].load(std::memory_order_relaxed);
+}
+}
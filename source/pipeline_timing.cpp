@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/pipeline_timing.h>
+
+namespace notifycpp {
+
+namespace {
+    std::uint64_t elapsed(std::uint64_t from, std::uint64_t to)
+    {
+        return to > from ? to - from : 0;
+    }
+}
+
+void PipelineTiming::record(const PipelineTimestamps& timestamps, std::uint64_t done)
+{
+    _Histograms[static_cast<std::size_t>(PipelineStage::decode)].record(elapsed(timestamps.read, timestamps.decoded));
+    _Histograms[static_cast<std::size_t>(PipelineStage::queue)].record(elapsed(timestamps.enqueued, timestamps.dispatched));
+    _Histograms[static_cast<std::size_t>(PipelineStage::observer)].record(elapsed(timestamps.dispatched, done));
+    _Histograms[static_cast<std::size_t>(PipelineStage::total)].record(elapsed(timestamps.read, done));
+}
+
+const LatencyHistogram& PipelineTiming::getHistogram(PipelineStage stage) const
+{
+    return _Histograms[static_cast<std::size_t>(stage)];
+}
+
+void PipelineTiming::reset()
+{
+    for (auto& histogram : _Histograms)
+        histogram.reset();
+}
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/process_info.h>
+
+#include <poll.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace notifycpp {
+
+namespace {
+    int openPidfd(pid_t pid)
+    {
+#ifdef SYS_pidfd_open
+        return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+        (void)pid;
+        return -1;
+#endif
+    }
+
+    std::string readFirstLine(const std::string& path)
+    {
+        std::ifstream stream(path);
+        std::string line;
+        std::getline(stream, line);
+        return line;
+    }
+
+    std::string readCgroup(pid_t pid)
+    {
+        std::ifstream stream("/proc/" + std::to_string(pid) + "/cgroup");
+        std::string line;
+        std::string first;
+        while (std::getline(stream, line)) {
+            if (line.compare(0, 3, "0::") == 0)
+                return line.substr(3);
+            if (first.empty())
+                first = line;
+        }
+        return first;
+    }
+}
+
+TProcessInfoPtr readProcessInfo(pid_t pid)
+{
+    auto info = std::make_shared<ProcessInfo>();
+    info->pid = pid;
+
+    const std::string proc = "/proc/" + std::to_string(pid);
+    info->comm = readFirstLine(proc + "/comm");
+
+    std::error_code ec;
+    info->exe = std::filesystem::read_symlink(proc + "/exe", ec);
+
+    info->cgroup = readCgroup(pid);
+    return info;
+}
+
+ProcessCache::ProcessCache(std::size_t maxEntries)
+    : _MaxEntries(maxEntries)
+{
+}
+
+ProcessCache::~ProcessCache()
+{
+    clear();
+}
+
+TProcessInfoPtr ProcessCache::lookup(pid_t pid, int pidfd)
+{
+    const auto found = _Entries.find(pid);
+    if (found != _Entries.end()) {
+        if (pidfd >= 0)
+            close(pidfd);
+        return found->second.info;
+    }
+
+    if (pidfd < 0)
+        pidfd = openPidfd(pid);
+
+    auto info = readProcessInfo(pid);
+
+    // Without a pidfd an exit can't be noticed, don't cache such entries
+    if (pidfd < 0)
+        return info;
+
+    if (_Entries.size() >= _MaxEntries)
+        clear();
+
+    _Entries.emplace(pid, Entry { info, pidfd });
+    return info;
+}
+
+/**
+ * @brief Drop the entries of all exited processes. A pidfd becomes
+ *        readable as soon as its process has terminated.
+ */
+void ProcessCache::sweep()
+{
+    if (_Entries.empty())
+        return;
+
+    std::vector<pollfd> fds;
+    std::vector<pid_t> pids;
+    fds.reserve(_Entries.size());
+    pids.reserve(_Entries.size());
+    for (const auto& entry : _Entries) {
+        fds.push_back({ entry.second.pidfd, POLLIN, 0 });
+        pids.push_back(entry.first);
+    }
+
+    if (poll(fds.data(), fds.size(), 0) <= 0)
+        return;
+
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+        if (fds[i].revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) {
+            close(fds[i].fd);
+            _Entries.erase(pids[i]);
+        }
+    }
+}
+
+std::size_t ProcessCache::size() const
+{
+    return _Entries.size();
+}
+
+void ProcessCache::clear()
+{
+    for (const auto& entry : _Entries)
+        close(entry.second.pidfd);
+    _Entries.clear();
+}
+}
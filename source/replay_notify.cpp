@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/replay_notify.h>
+
+#include <algorithm>
+
+namespace notifycpp {
+
+ReplayNotify::ReplayNotify(const EventJournal& journal, const ReplayOptions& options)
+    : _Options(options)
+    , _Next(0)
+    , _Started(false)
+{
+    if (_Options.batchSize == 0)
+        _Options.batchSize = 1;
+
+    std::uint64_t first = 0;
+    std::chrono::nanoseconds last(0);
+    journal.replay(_Options.from, [&](const JournalRecord& record) {
+        if (_Records.empty())
+            first = record.timestamp;
+        // CLOCK_REALTIME may step back, the replay must not
+        if (record.timestamp > first)
+            last = std::max(last, std::chrono::nanoseconds(record.timestamp - first));
+        _Records.push_back({ last, record.event });
+    });
+}
+
+void ReplayNotify::watchFile(const FileSystemEvent&)
+{
+}
+
+void ReplayNotify::watchDirectory(const FileSystemEvent&)
+{
+}
+
+void ReplayNotify::unwatch(const FileSystemEvent&)
+{
+}
+
+std::uint32_t ReplayNotify::getEventMask(const Event event) const
+{
+    return static_cast<std::uint32_t>(event);
+}
+
+/**
+ * @brief Move the next batch of due records to the queue of Notify and
+ *        return the first one, waiting for the recorded time if needed
+ */
+TFileSystemEventPtr ReplayNotify::getNextEvent()
+{
+    while (_Queue.empty()) {
+        if (_Next == _Records.size()) {
+            stop();
+            return nullptr;
+        }
+
+        if (_Options.speed > 0) {
+            const auto now = std::chrono::steady_clock::now();
+            if (!_Started) {
+                _Start = now;
+                _Started = true;
+            }
+            const auto due = getDue(_Records[_Next]);
+            if (due > now) {
+                std::unique_lock<std::mutex> lock(_Mutex);
+                _Wakeup.wait_until(lock, due, [this]() { return isStopped(); });
+            }
+        }
+        if (isStopped())
+            return nullptr;
+
+        const auto readTime = pipelineClock();
+        const auto now = std::chrono::steady_clock::now();
+        NotifyCounters::add(_Counters.syscalls);
+        for (std::size_t batch = 0; batch < _Options.batchSize && _Next < _Records.size(); ++batch) {
+            const auto& recorded = _Records[_Next];
+            if (_Options.speed > 0 && batch > 0 && getDue(recorded) > now)
+                break;
+            ++_Next;
+
+            NotifyCounters::add(_Counters.eventsDecoded);
+            if (isIgnored(recorded.event.getPath()) || isIgnoredOnce(recorded.event.getPath()))
+                NotifyCounters::add(_Counters.eventsIgnored);
+            else if (!isFiltered(recorded.event.getPath(), recorded.event.getEvent()))
+                enqueue(std::make_shared<FileSystemEvent>(recorded.event), readTime);
+        }
+    }
+    return dequeue();
+}
+
+std::chrono::steady_clock::time_point ReplayNotify::getDue(const Recorded& recorded) const
+{
+    const std::chrono::duration<double, std::nano> scaled(static_cast<double>(recorded.offset.count()) / _Options.speed);
+    return _Start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(scaled);
+}
+
+void ReplayNotify::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        Notify::stop();
+    }
+    _Wakeup.notify_all();
+}
+
+std::size_t ReplayNotify::size() const
+{
+    return _Records.size();
+}
+
+std::size_t ReplayNotify::remaining() const
+{
+    return _Records.size() - _Next;
+}
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/thread_options.h>
+
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace notifycpp {
+
+namespace {
+    int toPolicy(SchedulingPolicy policy)
+    {
+        switch (policy) {
+        case SchedulingPolicy::batch:
+            return SCHED_BATCH;
+        case SchedulingPolicy::idle:
+            return SCHED_IDLE;
+        case SchedulingPolicy::fifo:
+            return SCHED_FIFO;
+        case SchedulingPolicy::roundRobin:
+            return SCHED_RR;
+        default:
+            return SCHED_OTHER;
+        }
+    }
+
+    //! @return 0 or the errno of the failed call
+    int apply(const ThreadOptions& options, const char*& call)
+    {
+        if (!options.cpus.empty()) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            for (const auto cpu : options.cpus) {
+                if (cpu >= CPU_SETSIZE) {
+                    call = "CPU_SET";
+                    return EINVAL;
+                }
+                CPU_SET(cpu, &set);
+            }
+            call = "pthread_setaffinity_np";
+            if (const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+                return error;
+        }
+
+        if (options.policy != SchedulingPolicy::inherit) {
+            const int policy = toPolicy(options.policy);
+            sched_param param {};
+            if (policy == SCHED_FIFO || policy == SCHED_RR)
+                param.sched_priority = options.priority;
+            call = "pthread_setschedparam";
+            if (const int error = pthread_setschedparam(pthread_self(), policy, &param))
+                return error;
+        }
+        return 0;
+    }
+}
+
+void applyThreadOptions(const ThreadOptions& options)
+{
+    const char* call = "";
+    if (const int error = apply(options, call)) {
+        std::stringstream errorStream;
+        errorStream << "Couldn't apply thread options, " << call << ": " << strerror(error);
+        throw std::runtime_error(errorStream.str());
+    }
+}
+
+bool tryApplyThreadOptions(const ThreadOptions& options) noexcept
+{
+    const char* call = "";
+    return apply(options, call) == 0;
+}
+
+ReadBuffer::ReadBuffer(std::size_t size)
+    : _Data(nullptr)
+    , _Size(size)
+    , _Locked(false)
+{
+    place(false);
+}
+
+ReadBuffer::~ReadBuffer()
+{
+    release();
+}
+
+void ReadBuffer::place(bool lock)
+{
+    release();
+    // fresh anonymous pages, operator new may hand out memory some other thread touched
+    void* data = mmap(nullptr, _Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        std::stringstream errorStream;
+        errorStream << "Couldn't map read buffer of " << _Size << " bytes: " << strerror(errno);
+        throw std::runtime_error(errorStream.str());
+    }
+    _Data = static_cast<char*>(data);
+    // first touch: the pages come from the node of the calling thread
+    std::memset(_Data, 0, _Size);
+
+    if (lock) {
+        if (mlock(_Data, _Size) == -1) {
+            std::stringstream errorStream;
+            errorStream << "Couldn't lock read buffer of " << _Size << " bytes: " << strerror(errno);
+            throw std::runtime_error(errorStream.str());
+        }
+        _Locked = true;
+    }
+}
+
+void ReadBuffer::release()
+{
+    if (!_Data)
+        return;
+    if (_Locked)
+        munlock(_Data, _Size);
+    munmap(_Data, _Size);
+    _Data = nullptr;
+    _Locked = false;
+}
+
+char* ReadBuffer::data()
+{
+    return _Data;
+}
+
+std::size_t ReadBuffer::size() const
+{
+    return _Size;
+}
+
+bool ReadBuffer::isLocked() const
+{
+    return _Locked;
+}
+}
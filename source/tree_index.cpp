@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/tree_index.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+namespace notifycpp {
+
+namespace {
+    constexpr char SnapshotMagic[8] = { 'N', 'C', 'P', 'P', 'S', 'N', 'P', '1' };
+
+    enum SnapshotFlags : std::uint8_t {
+        SnapshotKnown = 1,
+        SnapshotDirectory = 2
+    };
+
+    // Snapshot record: parent record (uint32), flags (uint8), name length
+    // (uint16), inode, size (uint64), mtime (int64), name. Records are in
+    // preorder, the parent always precedes its children.
+    struct SnapshotRecord {
+        std::uint32_t parent;
+        std::uint8_t flags;
+        std::uint16_t nameLength;
+        std::uint64_t inode;
+        std::uint64_t size;
+        std::int64_t mtime;
+    };
+    constexpr std::size_t SnapshotRecordSize = sizeof(std::uint32_t) + sizeof(std::uint8_t) + sizeof(std::uint16_t)
+        + 3 * sizeof(std::uint64_t);
+
+    template <typename T>
+    void writeValue(std::ostream& out, const T& value)
+    {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool readValue(const std::string& data, std::size_t& offset, T& value)
+    {
+        if (offset + sizeof(value) > data.size())
+            return false;
+        memcpy(&value, data.data() + offset, sizeof(value));
+        offset += sizeof(value);
+        return true;
+    }
+
+    std::int64_t mtimeOf(const struct stat& st)
+    {
+        return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    // Report path and, for a directory, everything below it as created
+    void reportCreated(const std::filesystem::path& path, bool directory, std::vector<FileSystemEvent>& events)
+    {
+        events.emplace_back(path, Event::create);
+        if (!directory)
+            return;
+
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec);
+             !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+            events.emplace_back(it->path(), Event::create);
+    }
+}
+
+TreeIndex::TreeIndex()
+    : _Size(0)
+{
+    // node 0 is the parent of the first component of every path
+    _Nodes.push_back({ Invalid, Invalid, Invalid, true, false, 0, 0, 0, {} });
+}
+
+void TreeIndex::crawl(const std::filesystem::path& path)
+{
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    updateLocked(path);
+
+    std::error_code ec;
+    if (!std::filesystem::is_directory(std::filesystem::symlink_status(path, ec)))
+        return;
+
+    for (auto it = std::filesystem::recursive_directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+        updateLocked(it->path());
+}
+
+void TreeIndex::update(const std::filesystem::path& path)
+{
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    updateLocked(path);
+}
+
+void TreeIndex::remove(const std::filesystem::path& path)
+{
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    const auto node = find(path);
+    if (node != Invalid)
+        removeNode(node);
+}
+
+bool TreeIndex::apply(const FileSystemEvent& fse)
+{
+    const Event event = fse.getEvent();
+
+    if ((event & (Event::delete_sub | Event::moved_from | Event::delete_self | Event::move_self)) != Event(0)) {
+        remove(fse.getPath());
+        return false;
+    }
+
+    if ((event & (Event::create | Event::moved_to | Event::modify | Event::attrib | Event::close_write)) == Event(0))
+        return false;
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    updateLocked(fse.getPath());
+    if ((event & (Event::create | Event::moved_to)) == Event(0))
+        return false;
+
+    const auto node = find(fse.getPath());
+    return node != Invalid && _Nodes[node].directory;
+}
+
+std::optional<TreeEntry> TreeIndex::lookup(const std::filesystem::path& path) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    const auto node = find(path);
+    if (node == Invalid || !_Nodes[node].known)
+        return std::nullopt;
+    return toEntry(node);
+}
+
+std::vector<TreeEntry> TreeIndex::list(const std::filesystem::path& path) const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    std::vector<TreeEntry> entries;
+
+    const auto node = find(path);
+    if (node == Invalid || !_Nodes[node].known)
+        return entries;
+
+    entries.reserve(_Nodes[node].children.size());
+    for (const auto child : _Nodes[node].children) {
+        if (_Nodes[child].known)
+            entries.push_back(toEntry(child));
+    }
+    return entries;
+}
+
+std::size_t TreeIndex::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    return _Size;
+}
+
+std::vector<std::filesystem::path> TreeIndex::getDirectories() const
+{
+    std::shared_lock<std::shared_mutex> lock(_Mutex);
+    std::vector<std::filesystem::path> directories;
+    for (std::uint32_t node = 1; node < _Nodes.size(); ++node) {
+        if (_Nodes[node].known && _Nodes[node].directory)
+            directories.push_back(getPath(node));
+    }
+    return directories;
+}
+
+std::vector<FileSystemEvent> TreeIndex::diffDirectory(const std::filesystem::path& directory) const
+{
+    std::vector<FileSystemEvent> events;
+    std::unordered_map<std::string, TreeEntry> indexed;
+    {
+        std::shared_lock<std::shared_mutex> lock(_Mutex);
+        const auto node = find(directory);
+        if (node == Invalid || !_Nodes[node].known)
+            return events;
+        for (const auto child : _Nodes[node].children) {
+            if (_Nodes[child].known)
+                indexed.emplace(_Names[_Nodes[child].name], toEntry(child));
+        }
+    }
+
+    std::error_code ec;
+    for (auto it = std::filesystem::directory_iterator(directory, ec);
+         !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        struct stat st;
+        if (lstat(it->path().c_str(), &st) < 0)
+            continue;
+
+        const bool isDirectory = S_ISDIR(st.st_mode);
+        const auto found = indexed.find(it->path().filename().string());
+        if (found == std::end(indexed)) {
+            reportCreated(it->path(), isDirectory, events);
+            continue;
+        }
+
+        const TreeEntry& entry = found->second;
+        if (entry.inode != st.st_ino || entry.directory != isDirectory) {
+            // replaced by another file
+            events.emplace_back(it->path(), Event::delete_sub);
+            reportCreated(it->path(), isDirectory, events);
+        }
+        else if (!isDirectory && (entry.mtime != mtimeOf(st) || entry.size != static_cast<std::uintmax_t>(st.st_size))) {
+            events.emplace_back(it->path(), Event::modify);
+        }
+        indexed.erase(found);
+    }
+
+    // a vanished directory is reported by the diff of its parent
+    if (ec)
+        return events;
+
+    for (const auto& gone : indexed)
+        events.emplace_back(directory / gone.first, Event::delete_sub);
+    return events;
+}
+
+void TreeIndex::save(const std::filesystem::path& path) const
+{
+    std::filesystem::path tmp(path);
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(SnapshotMagic, sizeof(SnapshotMagic));
+
+        std::shared_lock<std::shared_mutex> lock(_Mutex);
+
+        // preorder from the virtual root, record numbers replace node ids
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> stack;
+        for (const auto child : _Nodes[0].children)
+            stack.emplace_back(child, Invalid);
+
+        std::uint32_t record = 0;
+        std::ostringstream records;
+        while (!stack.empty()) {
+            const auto [node, parent] = stack.back();
+            stack.pop_back();
+
+            const auto& entry = _Nodes[node];
+            const std::string& name = _Names[entry.name];
+            const SnapshotRecord header { parent,
+                static_cast<std::uint8_t>((entry.known ? SnapshotKnown : 0) | (entry.directory ? SnapshotDirectory : 0)),
+                static_cast<std::uint16_t>(name.size()),
+                static_cast<std::uint64_t>(entry.inode),
+                static_cast<std::uint64_t>(entry.size),
+                entry.mtime };
+            writeValue(records, header.parent);
+            writeValue(records, header.flags);
+            writeValue(records, header.nameLength);
+            writeValue(records, header.inode);
+            writeValue(records, header.size);
+            writeValue(records, header.mtime);
+            records.write(name.data(), static_cast<std::streamsize>(name.size()));
+
+            for (const auto child : entry.children)
+                stack.emplace_back(child, record);
+            ++record;
+        }
+
+        writeValue(out, record);
+        out << records.str();
+        if (!out) {
+            std::stringstream errorStream;
+            errorStream << "Couldn't write snapshot " << tmp << ".";
+            throw std::runtime_error(errorStream.str());
+        }
+    }
+    std::filesystem::rename(tmp, path);
+}
+
+void TreeIndex::load(const std::filesystem::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    const auto corrupt = [&path]() {
+        std::stringstream errorStream;
+        errorStream << "Invalid snapshot " << path << ".";
+        return std::runtime_error(errorStream.str());
+    };
+
+    std::uint32_t count = 0;
+    std::size_t offset = sizeof(SnapshotMagic);
+    if (data.size() < sizeof(SnapshotMagic) || memcmp(data.data(), SnapshotMagic, sizeof(SnapshotMagic)) != 0
+        || !readValue(data, offset, count) || count > (data.size() - offset) / SnapshotRecordSize)
+        throw corrupt();
+
+    // the live index is only replaced by a snapshot which is valid as a whole
+    TreeIndex loaded;
+    std::vector<std::uint32_t> nodes;
+    nodes.reserve(count);
+    for (std::uint32_t record = 0; record < count; ++record) {
+        SnapshotRecord header;
+        if (!readValue(data, offset, header.parent) || !readValue(data, offset, header.flags)
+            || !readValue(data, offset, header.nameLength) || !readValue(data, offset, header.inode)
+            || !readValue(data, offset, header.size) || !readValue(data, offset, header.mtime)
+            || offset + header.nameLength > data.size()
+            || (header.parent != Invalid && header.parent >= record))
+            throw corrupt();
+
+        const std::string name(data.data() + offset, header.nameLength);
+        offset += header.nameLength;
+
+        const std::uint32_t parent = header.parent == Invalid ? 0 : nodes[header.parent];
+        const auto nameId = loaded.internName(name);
+        if (loaded._Edges.count(edge(parent, nameId)))
+            throw corrupt();
+
+        const auto node = loaded.createNode(parent, nameId);
+        auto& entry = loaded._Nodes[node];
+        entry.known = header.flags & SnapshotKnown;
+        entry.directory = header.flags & SnapshotDirectory;
+        entry.inode = static_cast<ino_t>(header.inode);
+        entry.size = header.size;
+        entry.mtime = header.mtime;
+        if (entry.known)
+            ++loaded._Size;
+        nodes.push_back(node);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(_Mutex);
+    // swapping a deque keeps its elements in place, the name views stay valid
+    _Nodes.swap(loaded._Nodes);
+    _FreeNodes.swap(loaded._FreeNodes);
+    _Edges.swap(loaded._Edges);
+    _Names.swap(loaded._Names);
+    _NameIds.swap(loaded._NameIds);
+    _NameRefs.swap(loaded._NameRefs);
+    _FreeNames.swap(loaded._FreeNames);
+    _Size = loaded._Size;
+}
+
+std::uint32_t TreeIndex::find(const std::filesystem::path& path) const
+{
+    std::uint32_t node = 0;
+    for (const auto& component : path.lexically_normal()) {
+        const std::string name = component.string();
+        if (name.empty())
+            continue;
+
+        const auto nameId = findName(name);
+        if (nameId == Invalid)
+            return Invalid;
+
+        const auto found = _Edges.find(edge(node, nameId));
+        if (found == std::end(_Edges))
+            return Invalid;
+        node = found->second;
+    }
+    return node == 0 ? Invalid : node;
+}
+
+std::uint32_t TreeIndex::findOrCreate(const std::filesystem::path& path)
+{
+    std::uint32_t node = 0;
+    for (const auto& component : path.lexically_normal()) {
+        const std::string name = component.string();
+        if (name.empty())
+            continue;
+
+        const auto nameId = internName(name);
+        const auto found = _Edges.find(edge(node, nameId));
+        node = found != std::end(_Edges) ? found->second : createNode(node, nameId);
+    }
+    return node;
+}
+
+std::uint32_t TreeIndex::findName(const std::string& name) const
+{
+    const auto found = _NameIds.find(name);
+    return found != std::end(_NameIds) ? found->second : Invalid;
+}
+
+std::uint32_t TreeIndex::internName(const std::string& name)
+{
+    const auto found = _NameIds.find(name);
+    if (found != std::end(_NameIds))
+        return found->second;
+
+    // a deque never moves its elements, the views stay valid
+    std::uint32_t id;
+    if (!_FreeNames.empty()) {
+        id = _FreeNames.back();
+        _FreeNames.pop_back();
+        _Names[id] = name;
+    }
+    else {
+        id = static_cast<std::uint32_t>(_Names.size());
+        _Names.push_back(name);
+        _NameRefs.push_back(0);
+    }
+    _NameIds.emplace(_Names[id], id);
+    return id;
+}
+
+void TreeIndex::releaseName(std::uint32_t name)
+{
+    if (--_NameRefs[name] != 0)
+        return;
+
+    _NameIds.erase(_Names[name]);
+    std::string().swap(_Names[name]);
+    _FreeNames.push_back(name);
+}
+
+std::uint32_t TreeIndex::createNode(std::uint32_t parent, std::uint32_t name)
+{
+    std::uint32_t node;
+    if (!_FreeNodes.empty()) {
+        node = _FreeNodes.back();
+        _FreeNodes.pop_back();
+    }
+    else {
+        node = static_cast<std::uint32_t>(_Nodes.size());
+        _Nodes.emplace_back();
+    }
+
+    auto& children = _Nodes[parent].children;
+    _Nodes[node] = { parent, name, static_cast<std::uint32_t>(children.size()), true, false, 0, 0, 0, {} };
+    children.push_back(node);
+    _Nodes[parent].directory = true;
+    _Edges.emplace(edge(parent, name), node);
+    ++_NameRefs[name];
+    return node;
+}
+
+void TreeIndex::updateLocked(const std::filesystem::path& path)
+{
+    struct stat st;
+    if (lstat(path.c_str(), &st) < 0) {
+        const int error = errno;
+        const auto node = find(path);
+        if (node != Invalid && (error == ENOENT || error == ENOTDIR))
+            removeNode(node);
+        return;
+    }
+
+    const auto node = findOrCreate(path);
+    auto& entry = _Nodes[node];
+    const bool directory = S_ISDIR(st.st_mode);
+
+    // a directory replaced by a file loses its children
+    if (!directory) {
+        while (!entry.children.empty())
+            removeNode(entry.children.back());
+    }
+
+    if (!entry.known)
+        ++_Size;
+    entry.known = true;
+    entry.directory = directory;
+    entry.inode = st.st_ino;
+    entry.size = static_cast<std::uintmax_t>(st.st_size);
+    entry.mtime = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+void TreeIndex::removeNode(std::uint32_t node)
+{
+    while (!_Nodes[node].children.empty())
+        removeNode(_Nodes[node].children.back());
+
+    auto& entry = _Nodes[node];
+    auto& siblings = _Nodes[entry.parent].children;
+    const auto last = siblings.back();
+    siblings[entry.slot] = last;
+    _Nodes[last].slot = entry.slot;
+    siblings.pop_back();
+
+    _Edges.erase(edge(entry.parent, entry.name));
+    releaseName(entry.name);
+    if (entry.known)
+        --_Size;
+    entry = { Invalid, Invalid, Invalid, false, false, 0, 0, 0, {} };
+    _FreeNodes.push_back(node);
+}
+
+std::filesystem::path TreeIndex::getPath(std::uint32_t node) const
+{
+    std::vector<std::uint32_t> components;
+    for (; node != 0; node = _Nodes[node].parent)
+        components.push_back(_Nodes[node].name);
+
+    std::filesystem::path path;
+    for (auto it = components.rbegin(); it != components.rend(); ++it)
+        path /= _Names[*it];
+    return path;
+}
+
+TreeEntry TreeIndex::toEntry(std::uint32_t node) const
+{
+    const auto& entry = _Nodes[node];
+    return { _Names[entry.name], entry.inode, entry.size, entry.mtime, entry.directory };
+}
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include "bench_helper.hpp"
+
+#include "doctest.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+namespace {
+// Decodes the JSON string starting at the quote at offset
+std::string decodeJsonString(const std::string& json, std::size_t offset)
+{
+    REQUIRE(json.at(offset) == '"');
+    std::string value;
+    for (std::size_t i = offset + 1; i < json.size(); ++i) {
+        const char c = json[i];
+        REQUIRE(static_cast<unsigned char>(c) >= 0x20);
+        if (c == '"')
+            return value;
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+
+        const char escaped = json.at(++i);
+        if (escaped == 'n')
+            value += '\n';
+        else if (escaped == 't')
+            value += '\t';
+        else if (escaped == 'u')
+            value += static_cast<char>(std::strtol(json.substr(i + 1, 4).c_str(), nullptr, 16)), i += 4;
+        else
+            value += escaped;
+    }
+    FAIL("unterminated JSON string");
+    return value;
+}
+}
+
+TEST_CASE("shouldRoundTripBenchErrorRowThroughJson")
+{
+    // the quotes come from operator<< of std::filesystem::path
+    std::ostringstream error;
+    error << "Couldn't add monitor '" << std::filesystem::path("/tmp/a \\ b") << "':\n\tbad\x01";
+
+    const std::string row = "{\"backend\": " + jsonString("inotify") + ", \"error\": " + jsonString(error.str()) + "}";
+    CHECK(row.find('\n') == std::string::npos);
+
+    const auto field = row.find("\"error\": ");
+    REQUIRE(field != std::string::npos);
+    CHECK(decodeJsonString(row, field + 9) == error.str());
+    CHECK(decodeJsonString(row, row.find("\"inotify\"")) == "inotify");
+}
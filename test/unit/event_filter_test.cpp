@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/event_filter.h>
+
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+using namespace notifycpp;
+
+TEST_CASE("shouldMatchFilterExpression")
+{
+    const EventFilter filter("ext in {cpp,h} && under(\"/src\") && event & (modify|close_write)");
+
+    CHECK(filter.matches("/src/a.cpp", Event::modify));
+    CHECK(filter.matches("/src/lib/a.h", Event::close_write));
+    CHECK_FALSE(filter.matches("/src/a.cpp", Event::open));
+    CHECK_FALSE(filter.matches("/src/a.hpp", Event::modify));
+    CHECK_FALSE(filter.matches("/srcx/a.cpp", Event::modify));
+    CHECK_FALSE(filter.matches("/src/cpp", Event::modify));
+}
+
+TEST_CASE("shouldRespectPrecedenceAndNegation")
+{
+    const EventFilter filter("name == Makefile || ext == .txt && !event == delete");
+
+    CHECK(filter.matches("/a/Makefile", Event::delete_sub));
+    CHECK(filter.matches("/a/b.txt", Event::create));
+    CHECK_FALSE(filter.matches("/a/b.txt", Event::delete_sub));
+    CHECK_FALSE(filter.matches("/a/.txt", Event::create));
+
+    CHECK(EventFilter("!(false || true) || true").matches("/a", Event::open));
+    CHECK_FALSE(EventFilter("!(false || true)").matches("/a", Event::open));
+}
+
+TEST_CASE("shouldCompareFileSize")
+{
+    const auto file = std::filesystem::temp_directory_path() / "notifycpp_filter_size";
+    {
+        std::ofstream stream(file);
+        stream << std::string(2048, 'x');
+    }
+
+    CHECK(EventFilter("size >= 2k && size < 1M").matches(file.native(), Event::modify));
+    CHECK_FALSE(EventFilter("size > 2k").matches(file.native(), Event::modify));
+    std::filesystem::remove(file);
+    // the file is gone, there is no size to compare
+    CHECK_FALSE(EventFilter("size < 1G").matches(file.native(), Event::modify));
+}
+
+TEST_CASE("shouldRejectInvalidFilterExpression")
+{
+    CHECK_THROWS_AS(EventFilter("ext in {cpp"), std::invalid_argument);
+    CHECK_THROWS_AS(EventFilter("event & written"), std::invalid_argument);
+    CHECK_THROWS_AS(EventFilter("size ~ 1"), std::invalid_argument);
+    CHECK_THROWS_AS(EventFilter("true false"), std::invalid_argument);
+    CHECK_THROWS_AS(EventFilter("under(\"/src)"), std::invalid_argument);
+}
+
+TEST_CASE("shouldMatchGlobsInFilterExpression")
+{
+    const EventFilter filter("glob(\"*.cpp\", \"/src/**/*.h\") && !glob(\"third_party\")");
+
+    CHECK(filter.matches("/src/a.cpp", Event::modify));
+    CHECK(filter.matches("/src/x/y/a.h", Event::modify));
+    CHECK_FALSE(filter.matches("/lib/a.h", Event::modify));
+    CHECK_FALSE(filter.matches("/src/third_party/a.cpp", Event::modify));
+    CHECK_THROWS_AS(EventFilter("glob(\"[a\")"), std::invalid_argument);
+}
@@ -44,3 +44,27 @@ TEST_CASE("EventToStringTest")
     CHECK_EQ(toString(Event::access | Event::close_nowrite), std::string("access,close_nowrite"));
     CHECK_EQ(toString(Event::close_nowrite| Event::access), std::string("access,close_nowrite"));
 }
+
+TEST_CASE("EventInotifyTranslationTest")
+{
+    const EventHandler handler;
+    CHECK_EQ(handler.convertToInotifyEvents(Event::open | Event::close_write), std::uint32_t(IN_OPEN | IN_CLOSE_WRITE));
+    CHECK_EQ(handler.convertToInotifyEvents(Event::all), std::uint32_t(IN_ALL_EVENTS));
+    CHECK_EQ(handler.getInotify(IN_CREATE | IN_ISDIR), Event::create);
+    CHECK_EQ(handler.getInotify(IN_MOVED_FROM | IN_MOVED_TO), Event::move);
+    CHECK_EQ(handler.getInotify(IN_IGNORED), Event::none);
+}
+
+TEST_CASE("EventFanotifyTranslationTest")
+{
+    const EventHandler handler;
+    CHECK_EQ(handler.convertToFanotifyEvents(Event::open | Event::close), std::uint32_t(FAN_OPEN | FAN_CLOSE));
+    CHECK_EQ(handler.convertToFanotifyEvents(Event::create), std::uint32_t(0));
+    CHECK_EQ(handler.getFanotify(FAN_OPEN | FAN_CLOSE_WRITE), Event::open | Event::close_write);
+
+    const std::vector<Event> events = handler.getFanotifyEvents(FAN_OPEN | FAN_CLOSE_WRITE | FAN_ONDIR);
+    REQUIRE_EQ(events.size(), 2);
+    CHECK_EQ(events[0], Event::close_write);
+    CHECK_EQ(events[1], Event::open);
+    CHECK(handler.getFanotifyEvents(FAN_OPEN_PERM).empty());
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/event_journal.h>
+#include <notify-cpp/notify_controller.h>
+
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+namespace {
+struct JournalDirectory {
+    JournalDirectory()
+        : path(std::filesystem::temp_directory_path() / "notifycpp_journal_test")
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    ~JournalDirectory()
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    std::size_t segments() const
+    {
+        return static_cast<std::size_t>(std::distance(std::filesystem::directory_iterator(path), std::filesystem::directory_iterator()));
+    }
+
+    std::filesystem::path path;
+};
+}
+
+TEST_CASE_FIXTURE(JournalDirectory, "shouldReplayJournalAfterReopen")
+{
+    {
+        EventJournal journal(path);
+        CHECK(journal.getLastSequence() == 0);
+        CHECK(journal.append(FileSystemEvent("/tmp/a", Event::open, 42)) == 1);
+        CHECK(journal.append(FileSystemEvent("/tmp/b", Event::close_write)) == 2);
+        CHECK(journal.append(FileSystemEvent("/tmp/c", Event::modify)) == 3);
+    }
+
+    EventJournal journal(path);
+    CHECK(journal.getLastSequence() == 3);
+    CHECK(journal.append(FileSystemEvent("/tmp/d", Event::attrib)) == 4);
+
+    std::vector<JournalRecord> records;
+    CHECK(journal.replay(2, [&](const JournalRecord& record) { records.push_back(record); }) == 4);
+    REQUIRE(records.size() == 3);
+    CHECK(records[0].sequence == 2);
+    CHECK(records[0].event.getPath() == "/tmp/b");
+    CHECK(records[0].event.getEvent() == Event::close_write);
+    CHECK(records[2].event.getEvent() == Event::attrib);
+    CHECK(records[0].timestamp <= records[2].timestamp);
+
+    std::vector<JournalRecord> first;
+    journal.replay(1, [&](const JournalRecord& record) { first.push_back(record); });
+    REQUIRE(first.size() == 4);
+    CHECK(first[0].event.getPid() == 42);
+}
+
+TEST_CASE_FIXTURE(JournalDirectory, "shouldStopReplayAtCorruptRecord")
+{
+    {
+        EventJournal journal(path);
+        journal.append(FileSystemEvent("/tmp/a", Event::open));
+        journal.append(FileSystemEvent("/tmp/b", Event::open));
+        journal.append(FileSystemEvent("/tmp/c", Event::open));
+        journal.sync();
+    }
+
+    // flip a path byte of the second record: segment header, first record, record header
+    {
+        const auto segment = std::filesystem::directory_iterator(path)->path();
+        std::fstream file(segment, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(16 + 48 + 40);
+        file.put('x');
+    }
+
+    EventJournal journal(path);
+    CHECK(journal.getLastSequence() == 1);
+
+    std::vector<JournalRecord> records;
+    CHECK(journal.replay(1, [&](const JournalRecord& record) { records.push_back(record); }) == 1);
+    REQUIRE(records.size() == 1);
+    CHECK(records[0].event.getPath() == "/tmp/a");
+
+    CHECK(journal.append(FileSystemEvent("/tmp/d", Event::open)) == 2);
+    records.clear();
+    CHECK(journal.replay(1, [&](const JournalRecord& record) { records.push_back(record); }) == 2);
+    REQUIRE(records.size() == 2);
+    CHECK(records[1].event.getPath() == "/tmp/d");
+}
+
+TEST_CASE_FIXTURE(JournalDirectory, "shouldRotateJournalSegments")
+{
+    EventJournalOptions options;
+    options.segmentSize = 16 * 1024;
+    options.maxSegments = 2;
+
+    EventJournal journal(path, options);
+    const std::string name(200, 'x');
+    for (int i = 0; i < 500; ++i)
+        journal.append(FileSystemEvent("/tmp/" + name + std::to_string(i), Event::modify));
+
+    CHECK(journal.getLastSequence() == 500);
+    CHECK(segments() == 2);
+
+    std::uint64_t expected = 0;
+    std::size_t replayed = 0;
+    journal.replay(1, [&](const JournalRecord& record) {
+        if (expected != 0)
+            CHECK(record.sequence == expected);
+        expected = record.sequence + 1;
+        ++replayed;
+    });
+    CHECK(expected == 501);
+    CHECK(replayed < 500);
+}
+
+TEST_CASE_FIXTURE(JournalDirectory, "shouldReplayJournalThroughObservers")
+{
+    EventJournal journal(path);
+    journal.append(FileSystemEvent("/tmp/a", Event::open));
+    journal.append(FileSystemEvent("/tmp/b", Event::close_write));
+    journal.append(FileSystemEvent("/tmp/c", Event::open));
+
+    std::vector<std::filesystem::path> opened;
+    std::size_t unexpected = 0;
+    InotifyController notifier = InotifyController();
+    notifier.onEvent(Event::open, [&](Notification notification) { opened.push_back(notification.getPath()); })
+        .onUnexpectedEvent([&](Notification) { ++unexpected; });
+
+    CHECK(notifier.replay(journal) == 3);
+    CHECK(opened == std::vector<std::filesystem::path> { "/tmp/a", "/tmp/c" });
+    CHECK(unexpected == 1);
+}
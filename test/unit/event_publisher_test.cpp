@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/event_publisher.h>
+#include <notify-cpp/notify_controller.h>
+
+#include "doctest.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace notifycpp;
+using namespace std::chrono_literals;
+
+TEST_CASE("shouldIsolateSlowSubscribers")
+{
+    FakeNotifyController notifier;
+    std::atomic<std::size_t> fast(0);
+    std::promise<void> release;
+    auto released = release.get_future().share();
+
+    SubscriberOptions slowOptions;
+    slowOptions.queueSize = 16;
+    auto slow = notifier.subscribe(slowOptions, [released](Notification) { released.wait(); });
+    auto quick = notifier.subscribe(SubscriberOptions(), [&fast](Notification) { ++fast; });
+
+    notifier.getFakeNotify().injectAtRate({ "/fake/a", Event::modify }, 100, 0);
+    for (int i = 0; i < 100; ++i)
+        notifier.runOnce();
+
+    const auto timeout = std::chrono::steady_clock::now() + 5s;
+    while (fast < 100 && std::chrono::steady_clock::now() < timeout)
+        std::this_thread::sleep_for(1ms);
+    CHECK(fast == 100);
+    CHECK(quick->getDropped() == 0);
+
+    // the slow subscriber holds at most one event and a full queue
+    CHECK(slow->getDropped() >= 100 - 16 - 1);
+
+    release.set_value();
+    notifier.unsubscribe(slow);
+    CHECK(slow->getDelivered() + slow->getDropped() == 100);
+    CHECK(slow->getPending() == 0);
+}
+
+TEST_CASE("shouldFilterSubscribersByEventAndPath")
+{
+    FakeNotifyController notifier;
+    std::vector<std::string> paths;
+
+    SubscriberOptions options;
+    options.event = Event::modify;
+    options.paths = { "/fake/src/" };
+    auto subscriber = notifier.subscribe(options, [&paths](Notification notification) { paths.push_back(notification.getPath()); });
+
+    auto& fake = notifier.getFakeNotify();
+    fake.inject({ "/fake/src/a.cpp", Event::modify });
+    fake.inject({ "/fake/srcx/b.cpp", Event::modify });
+    fake.inject({ "/fake/src/c.cpp", Event::open });
+    fake.inject({ "/fake/src", Event::modify });
+    for (int i = 0; i < 4; ++i)
+        notifier.runOnce();
+
+    notifier.unsubscribe(subscriber);
+    CHECK(paths == std::vector<std::string> { "/fake/src/a.cpp", "/fake/src" });
+}
+
+TEST_CASE("shouldBlockPublisherIfRequested")
+{
+    EventPublisher publisher;
+    std::vector<std::string> paths;
+
+    SubscriberOptions options;
+    options.queueSize = 1;
+    options.overflow = SubscriberOverflow::block;
+    auto subscriber = publisher.subscribe(options, [&paths](Notification notification) {
+        std::this_thread::sleep_for(1ms);
+        paths.push_back(notification.getPath());
+    });
+
+    for (int i = 0; i < 20; ++i)
+        publisher.publish(std::make_shared<FileSystemEvent>("/fake/" + std::to_string(i), Event::close_write));
+    publisher.unsubscribe(subscriber);
+
+    CHECK(publisher.size() == 0);
+    CHECK(subscriber->getDropped() == 0);
+    REQUIRE(paths.size() == 20);
+    CHECK(paths.back() == "/fake/19");
+}
+
+TEST_CASE("shouldCountFailingObserversAndKeepDelivering")
+{
+    EventPublisher publisher;
+    std::vector<std::string> paths;
+
+    auto subscriber = publisher.subscribe(SubscriberOptions(), [&paths](Notification notification) {
+        if (notification.getPath() == "/fake/1")
+            throw std::runtime_error("observer failed");
+        paths.push_back(notification.getPath());
+    });
+
+    for (int i = 0; i < 3; ++i)
+        publisher.publish(std::make_shared<FileSystemEvent>("/fake/" + std::to_string(i), Event::close_write));
+    publisher.unsubscribe(subscriber);
+
+    CHECK(subscriber->getFailed() == 1);
+    CHECK(subscriber->getDelivered() == 2);
+    CHECK(paths == std::vector<std::string> { "/fake/0", "/fake/2" });
+}
+
+TEST_CASE("shouldReleaseSubscriberFromItsOwnObserver")
+{
+    EventPublisher publisher;
+    std::promise<void> released;
+    TSubscriberPtr subscriber;
+
+    // the last reference goes away on the subscriber thread
+    subscriber = publisher.subscribe(SubscriberOptions(), [&](Notification) {
+        publisher.unsubscribe(subscriber);
+        subscriber.reset();
+        released.set_value();
+    });
+    publisher.publish(std::make_shared<FileSystemEvent>("/fake/a", Event::close_write));
+
+    CHECK(released.get_future().wait_for(1s) == std::future_status::ready);
+    CHECK(publisher.size() == 0);
+}
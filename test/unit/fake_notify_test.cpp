@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/event_journal.h>
+#include <notify-cpp/fake_notify.h>
+#include <notify-cpp/notify_controller.h>
+
+#include "doctest.h"
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace notifycpp;
+using namespace std::chrono_literals;
+
+TEST_CASE("shouldDispatchInjectedEvents")
+{
+    FakeNotifyController notifier;
+    std::vector<std::filesystem::path> opened;
+    std::size_t unexpected = 0;
+    notifier.watchFile({ "/fake/a", Event::open })
+        .onEvent(Event::open, [&](Notification notification) { opened.push_back(notification.getPath()); })
+        .onUnexpectedEvent([&](Notification) { ++unexpected; });
+
+    CHECK(notifier.getFakeNotify().isWatched("/fake/a"));
+
+    notifier.getFakeNotify().inject({ "/fake/a", Event::open });
+    notifier.getFakeNotify().inject({ "/fake/b", Event::modify });
+    notifier.getFakeNotify().inject({ "/fake/c", Event::open });
+    for (int i = 0; i < 3; ++i)
+        notifier.runOnce();
+
+    CHECK(opened == std::vector<std::filesystem::path> { "/fake/a", "/fake/c" });
+    CHECK(unexpected == 1);
+    CHECK(notifier.getStats().observerInvocations == 3);
+}
+
+TEST_CASE("shouldDeliverOnVirtualClock")
+{
+    FakeNotify fake;
+    fake.injectAtRate({ "/fake/a", Event::modify }, 10, 1000);
+    CHECK(fake.pending() == 10);
+
+    // one event every millisecond, the first is due immediately
+    CHECK(fake.getNextEvent() != nullptr);
+    CHECK(fake.pending() == 9);
+
+    fake.advance(4500us);
+    std::size_t delivered = 0;
+    for (int i = 0; i < 4; ++i)
+        delivered += fake.getNextEvent() != nullptr;
+    CHECK(delivered == 4);
+    CHECK(fake.pending() == 5);
+    CHECK(fake.now() == 4500us);
+}
+
+TEST_CASE("shouldUnblockOnStop")
+{
+    FakeNotify fake;
+    std::thread thread([&fake]() { CHECK(fake.getNextEvent() == nullptr); });
+    fake.stop();
+    thread.join();
+}
+
+TEST_CASE("shouldSimulateOverflow")
+{
+    FakeNotify fake;
+    fake.setQueueLimit(2);
+    for (int i = 0; i < 5; ++i)
+        fake.inject({ "/fake/" + std::to_string(i), Event::create });
+
+    CHECK(fake.pending() == 2);
+    CHECK(fake.getStats().overflows == 1);
+    CHECK(fake.getStats().eventsIgnored == 3);
+
+    fake.overflow();
+    CHECK(fake.pending() == 0);
+    CHECK(fake.getStats().overflows == 2);
+}
+
+TEST_CASE("shouldReorderDeterministically")
+{
+    const auto order = [](std::uint64_t seed) {
+        FakeNotify fake;
+        for (int i = 0; i < 16; ++i)
+            fake.inject({ "/fake/" + std::to_string(i), Event::modify });
+        fake.inject({ "/fake/later", Event::modify }, 1s);
+        fake.reorder(seed);
+
+        std::vector<std::filesystem::path> paths;
+        for (int i = 0; i < 16; ++i)
+            paths.push_back(fake.getNextEvent()->getPath());
+        CHECK(fake.pending() == 1);
+        return paths;
+    };
+
+    const auto first = order(42);
+    CHECK(first == order(42));
+    CHECK(first != order(7));
+}
+
+namespace {
+struct TraceDirectory {
+    TraceDirectory()
+        : path(std::filesystem::temp_directory_path() / "notifycpp_replay_test")
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    ~TraceDirectory()
+    {
+        std::filesystem::remove_all(path);
+    }
+
+    std::filesystem::path path;
+};
+}
+
+TEST_CASE_FIXTURE(TraceDirectory, "shouldReplayRecordedTrace")
+{
+    auto journal = std::make_shared<EventJournal>(path);
+    {
+        FakeNotifyController recorder;
+        recorder.setJournal(journal);
+        recorder.getFakeNotify().inject({ "/fake/a", Event::create });
+        recorder.getFakeNotify().inject({ "/fake/a", Event::modify });
+        recorder.getFakeNotify().inject({ "/fake/b", Event::delete_sub });
+        for (int i = 0; i < 3; ++i)
+            recorder.runOnce();
+    }
+
+    ReplayOptions options;
+    options.speed = 0;
+    options.from = 2;
+    ReplayNotifyController notifier(*journal, options);
+    std::vector<Event> events;
+    notifier.onEvents({ Event::create, Event::modify, Event::delete_sub }, [&](Notification notification) { events.push_back(notification.getEvent()); });
+
+    // run() returns after the last record
+    notifier.run();
+    CHECK(events == std::vector<Event> { Event::modify, Event::delete_sub });
+}
+
+TEST_CASE_FIXTURE(TraceDirectory, "shouldReplayAtRecordedSpeed")
+{
+    EventJournal journal(path);
+    journal.append({ "/fake/a", Event::modify });
+    std::this_thread::sleep_for(100ms);
+    journal.append({ "/fake/a", Event::modify });
+
+    const auto replay = [&journal](double speed) {
+        ReplayOptions options;
+        options.speed = speed;
+        ReplayNotify replay(journal, options);
+        const auto start = std::chrono::steady_clock::now();
+        while (replay.getNextEvent())
+            ;
+        CHECK(replay.remaining() == 0);
+        return std::chrono::steady_clock::now() - start;
+    };
+
+    CHECK(replay(1) >= 100ms);
+    CHECK(replay(0) < 100ms);
+}
+
+TEST_CASE("shouldDropFilteredEventsBeforeDispatch")
+{
+    FakeNotifyController notifier;
+    std::vector<std::filesystem::path> paths;
+    notifier.setFilter("ext in {cpp,h} && event & (modify|close_write)")
+        .onUnexpectedEvent([&](Notification notification) { paths.push_back(notification.getPath()); });
+
+    auto& fake = notifier.getFakeNotify();
+    fake.inject({ "/fake/a.cpp", Event::modify });
+    fake.inject({ "/fake/b.txt", Event::modify });
+    fake.inject({ "/fake/c.h", Event::open });
+    fake.inject({ "/fake/d.h", Event::close_write });
+    notifier.runOnce();
+    notifier.runOnce();
+
+    CHECK(paths == std::vector<std::filesystem::path> { "/fake/a.cpp", "/fake/d.h" });
+    CHECK(notifier.getStats().eventsIgnored == 2);
+    CHECK(notifier.getStats().observerInvocations == 2);
+}
+
+TEST_CASE("shouldShareBackendBetweenControllerCopies")
+{
+    static_assert(std::has_virtual_destructor<Notify>::value, "backends are deleted through Notify");
+
+    std::size_t modified = 0;
+    NotifyController copy;
+    {
+        FakeNotifyController notifier;
+        notifier.onEvent(Event::modify, [&](Notification) { ++modified; });
+        copy = notifier;
+        notifier.getFakeNotify().inject({ "/fake/a", Event::modify });
+    }
+
+    // the backend outlives the controller it was created by
+    copy.runOnce();
+    CHECK(modified == 1);
+    CHECK(copy.getStats().observerInvocations == 1);
+}
@@ -27,6 +27,7 @@
 
 #include "doctest.h"
 
+#include <atomic>
 #include <thread>
 #include <chrono>
 #include <filesystem>
@@ -34,6 +35,10 @@
 #include <future>
 #include <iostream>
 
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
 using namespace notifycpp;
 
 
@@ -146,6 +151,42 @@ TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldIgnoreFile")
     thread.join();
 }
 
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldWatchEntriesOfDirectory")
+{
+    NotifyController notifier = FanotifyController();
+    notifier.watchDirectory({testDirectory_, Event::close_write})
+        .onEvent(Event::close_write, [&](Notification notification) { promisedOpen_.set_value(notification); });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureEvent = promisedOpen_.get_future();
+    CHECK(futureEvent.wait_for(timeout_) == std::future_status::ready);
+    CHECK(futureEvent.get().getPath() == std::filesystem::canonical(testFileOne_));
+    notifier.stop();
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldWatchMountPointWithEventMask")
+{
+    FanotifyController notifier = FanotifyController();
+    notifier.watchMountPoint({testDirectory_, Event::close_write});
+    notifier.onEvent(Event::close_write, [&](Notification notification) {
+        if (notification.getPath() == std::filesystem::canonical(testFileOne_))
+            promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    openFile(testFileOne_);
+
+    auto futureEvent = promisedOpen_.get_future();
+    CHECK(futureEvent.wait_for(timeout_) == std::future_status::ready);
+    notifier.stop();
+    thread.join();
+}
+
 TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldUnwatchPath")
 {
     FanotifyController notifier = FanotifyController();
@@ -225,3 +266,215 @@ TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldIgnoreFileOnce")
     notifier.stop();
     thread.join();
 }
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldDenyOpenByPermissionHandler")
+{
+    FanotifyOptions options;
+    options.fanClass = FanotifyClass::content;
+
+    FanotifyController notifier = FanotifyController(options);
+    notifier.onPermission([&](const FileSystemEvent& fse) {
+        return fse.getPath().filename() == testFileOne_.filename() ? Verdict::deny : Verdict::allow;
+    });
+    notifier.watchFile({testFileOne_, Event::open});
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    std::ifstream denied(testFileOne_);
+    CHECK_FALSE(denied.is_open());
+
+    notifier.unwatch(testFileOne_);
+    std::ifstream allowed(testFileOne_);
+    CHECK(allowed.is_open());
+
+    notifier.stop();
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldAnswerPermissionEventsOnVerdictWorkers")
+{
+    FanotifyOptions options;
+    options.fanClass = FanotifyClass::content;
+
+    std::atomic<size_t> asked(0);
+    FanotifyController notifier = FanotifyController(options);
+    notifier.setVerdictWorkers(2);
+    notifier.setVerdictCacheSize(16);
+    notifier.onPermission([&](const FileSystemEvent&) {
+        ++asked;
+        return Verdict::allow;
+    });
+    notifier.watchFile({testFileTwo_, Event::open});
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    // The second open is answered from the verdict cache
+    std::ifstream first(testFileTwo_);
+    CHECK(first.is_open());
+    std::ifstream second(testFileTwo_);
+    CHECK(second.is_open());
+    CHECK_EQ(asked.load(), 1);
+
+    notifier.unwatch(testFileTwo_);
+    notifier.stop();
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldFallBackIfPermissionHandlerThrows")
+{
+    for (const std::size_t workers : { 0, 2 }) {
+        FanotifyOptions options;
+        options.fanClass = FanotifyClass::content;
+        options.fallbackVerdict = workers == 0 ? Verdict::allow : Verdict::deny;
+
+        FanotifyController notifier = FanotifyController(options);
+        notifier.setVerdictWorkers(workers);
+        notifier.onPermission([](const FileSystemEvent&) -> Verdict {
+            throw std::runtime_error("handler failed");
+        });
+        notifier.watchFile({testFileOne_, Event::open});
+
+        std::thread thread([&notifier]() { notifier.run(); });
+
+        // a failed decision is not cached, every open asks again
+        for (int i = 0; i < 2; ++i) {
+            std::ifstream stream(testFileOne_);
+            CHECK(stream.is_open() == (options.fallbackVerdict == Verdict::allow));
+        }
+        CHECK(notifier.getStats().permissionErrors == 2);
+
+        notifier.unwatch(testFileOne_);
+        notifier.stop();
+        thread.join();
+    }
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldDecidePermissionPerProcess")
+{
+    FanotifyOptions options;
+    options.fanClass = FanotifyClass::content;
+
+    const pid_t self = getpid();
+    FanotifyController notifier = FanotifyController(options);
+    notifier.onPermission([self](const FileSystemEvent& fse) {
+        return fse.getPid() == self ? Verdict::allow : Verdict::deny;
+    });
+    notifier.watchFile({testFileOne_, Event::open});
+
+    std::thread thread([&notifier]() { notifier.run(); });
+
+    std::ifstream allowed(testFileOne_);
+    CHECK(allowed.is_open());
+
+    // the verdict of the first open must not be reused for another process
+    const pid_t child = fork();
+    REQUIRE(child >= 0);
+    if (child == 0) {
+        const int fd = open(testFileOne_.c_str(), O_RDONLY);
+        _exit(fd < 0 ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    CHECK(WIFEXITED(status));
+    CHECK(WEXITSTATUS(status) == 0);
+
+    notifier.unwatch(testFileOne_);
+    notifier.stop();
+    thread.join();
+}
+
+TEST_CASE("shouldRejectTidTogetherWithPidfd")
+{
+    FanotifyOptions options;
+    options.reportTid = true;
+    options.reportPidfd = true;
+    CHECK_THROWS_AS(FanotifyController { options }, std::runtime_error);
+
+    options.reportPidfd = false;
+    CHECK_NOTHROW(FanotifyController { options });
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldAttributeEventToProcess")
+{
+    FanotifyOptions options;
+    options.reportPidfd = true;
+    options.processInfo = true;
+
+    NotifyController notifier = FanotifyController(options).watchFile({testFileOne_, Event::open}).onEvent(Event::open, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpenEvent = promisedOpen_.get_future();
+    REQUIRE(futureOpenEvent.wait_for(timeout_) == std::future_status::ready);
+    const auto notify = futureOpenEvent.get();
+    CHECK_EQ(notify.getPid(), getpid());
+    REQUIRE(notify.getProcessInfo());
+    CHECK_EQ(notify.getProcessInfo()->pid, getpid());
+    CHECK_EQ(notify.getProcessInfo()->exe, std::filesystem::read_symlink("/proc/self/exe"));
+    CHECK_FALSE(notify.getProcessInfo()->comm.empty());
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldIgnoreWatchedFile")
+{
+    NotifyController notifier = FanotifyController().watchFile({testFileOne_, Event::close}).ignore(testFileOne_).onEvent(Event::close, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+    openFile(testFileOne_);
+
+    auto futureOpenEvent = promisedOpen_.get_future();
+    CHECK(futureOpenEvent.wait_for(timeout_) == std::future_status::timeout);
+    notifier.stop();
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldHandEventFdToObserver")
+{
+    FanotifyOptions options;
+    options.keepEventFd = true;
+
+    std::promise<std::string> promisedContent;
+    NotifyController notifier = FanotifyController(options).watchFile({testFileOne_, Event::close_write}).onEvent(Event::close_write, [&](Notification notification) {
+        const auto fd = notification.getFileDescriptor();
+        std::string content(64, '\0');
+        const ssize_t length = fd ? pread(fd->get(), &content[0], content.size(), 0) : -1;
+        promisedContent.set_value(content.substr(0, length < 0 ? 0 : length));
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureContent = promisedContent.get_future();
+    REQUIRE(futureContent.wait_for(timeout_) == std::future_status::ready);
+    CHECK_EQ(futureContent.get(), std::string("Writing this to a file.\n"));
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldNotifyWithUnlimitedQueueAndSmallBuffer")
+{
+    FanotifyOptions options;
+    options.unlimitedQueue = true;
+    options.unlimitedMarks = true;
+    options.bufferSize = sizeof(fanotify_event_metadata);
+
+    NotifyController notifier = FanotifyController(options).watchFile({testFileOne_, Event::close_write}).onEvent(Event::close_write, [&](Notification notification) {
+        promisedCloseNoWrite_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureClose = promisedCloseNoWrite_.get_future();
+    CHECK(futureClose.wait_for(timeout_) == std::future_status::ready);
+    thread.join();
+}
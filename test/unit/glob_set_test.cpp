@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/fake_notify.h>
+#include <notify-cpp/glob_set.h>
+#include <notify-cpp/notify_controller.h>
+
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+TEST_CASE("shouldMatchComponentPatterns")
+{
+    const GlobSet globs({ "node_modules", "*.log", "*.tar.gz", "core.[0-9]*", "?.tmp", ".#*" });
+
+    CHECK(globs.matches("/src/node_modules"));
+    CHECK(globs.matches("/src/node_modules/lib/index.js"));
+    CHECK(globs.matches("/var/app.log"));
+    CHECK(globs.matches("/var/old.log/x"));
+    CHECK(globs.matches("/a/b.tar.gz"));
+    CHECK(globs.matches("/a/core.123"));
+    CHECK(globs.matches("/a/x.tmp"));
+    CHECK(globs.matches("/a/.#lock"));
+
+    CHECK_FALSE(globs.matches("/src/node_module"));
+    CHECK_FALSE(globs.matches("/var/app.logs"));
+    CHECK_FALSE(globs.matches("/var/app.log.d/x"));
+    CHECK_FALSE(globs.matches("/a/b.gz"));
+    CHECK_FALSE(globs.matches("/a/core.x"));
+    CHECK_FALSE(globs.matches("/a/xy.tmp"));
+}
+
+TEST_CASE("shouldMatchPathPatterns")
+{
+    const GlobSet globs({ "/srv/cache", "/srv/*/tmp/", "build/out", "/home/**/.git", "/data/**/*.bak", "/a/[!x]b" });
+
+    CHECK(globs.matches("/srv/cache"));
+    CHECK(globs.matches("/srv/cache/1/2"));
+    CHECK_FALSE(globs.matches("/srv/cached"));
+
+    CHECK(globs.matches("/srv/app/tmp/x"));
+    CHECK_FALSE(globs.matches("/srv/app/sub/tmp/x"));
+
+    CHECK(globs.matches("/x/y/build/out/a.o"));
+    CHECK_FALSE(globs.matches("/x/y/rebuild/out/a.o"));
+
+    CHECK(globs.matches("/home/.git"));
+    CHECK(globs.matches("/home/u/p/.git/config"));
+    CHECK(globs.matches("/data/a/b/c.bak"));
+    CHECK(globs.matches("/data/c.bak"));
+    CHECK_FALSE(globs.matches("/data/c.bak2"));
+
+    CHECK(globs.matches("/a/yb"));
+    CHECK_FALSE(globs.matches("/a/xb"));
+}
+
+TEST_CASE("shouldMatchManyPatterns")
+{
+    std::vector<std::string> patterns;
+    for (int i = 0; i < 10000; ++i)
+        patterns.push_back("/repo/module" + std::to_string(i) + "/gen*/");
+    const GlobSet globs(patterns);
+
+    CHECK(globs.size() == 10000);
+    CHECK(globs.matches("/repo/module4711/generated/a.cpp"));
+    CHECK_FALSE(globs.matches("/repo/module4711/src/a.cpp"));
+    CHECK_FALSE(globs.matches("/repo/module10000/generated/a.cpp"));
+}
+
+TEST_CASE("shouldRejectInvalidGlobs")
+{
+    CHECK_THROWS_AS(GlobSet({ "" }), std::invalid_argument);
+    CHECK_THROWS_AS(GlobSet({ "!keep.log" }), std::invalid_argument);
+    CHECK_THROWS_AS(GlobSet({ "[a-z" }), std::invalid_argument);
+    CHECK(GlobSet().empty());
+    CHECK_FALSE(GlobSet().matches("/a"));
+}
+
+TEST_CASE("shouldSkipIgnoredPatternsWhileCrawling")
+{
+    const auto root = std::filesystem::temp_directory_path() / "notifycpp_glob_crawl";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "node_modules" / "lib");
+    std::filesystem::create_directories(root / "src");
+    for (const auto& file : { root / "node_modules" / "lib" / "a.js", root / "src" / "a.cpp", root / "src" / "a.o" })
+        std::ofstream(file.string()) << "x";
+
+    FakeNotifyController notifier;
+    notifier.ignorePatterns({ "node_modules", "*.o" }).watchPathRecursively({ root, Event::modify });
+    auto& fake = notifier.getFakeNotify();
+    CHECK(fake.isWatched(root / "src" / "a.cpp"));
+    CHECK_FALSE(fake.isWatched(root / "src" / "a.o"));
+    CHECK_FALSE(fake.isWatched(root / "node_modules" / "lib" / "a.js"));
+    // node_modules itself is visited, nothing below it
+    CHECK(notifier.getStats().crawledPaths == 4);
+
+    std::size_t called = 0;
+    notifier.onEvent(Event::modify, [&called](Notification) { ++called; });
+    fake.inject({ root / "src" / "a.cpp", Event::modify });
+    fake.inject({ root / "src" / "b.o", Event::modify });
+    notifier.runOnce();
+    CHECK(called == 1);
+    CHECK(notifier.getStats().eventsIgnored == 1);
+
+    std::filesystem::remove_all(root);
+}
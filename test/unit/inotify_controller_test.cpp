@@ -20,6 +20,7 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
  * SOFTWARE.
  */
+#include <notify-cpp/basic_notify_controller.h>
 #include <notify-cpp/inotify.h>
 #include <notify-cpp/event.h>
 #include <notify-cpp/notify_controller.h>
@@ -28,11 +29,13 @@
 
 #include "filesystem_event_helper.hpp"
 
+#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <thread>
 
 /*
  * The test cases based on the original work from Erik Zenker for inotify-cpp.
@@ -150,6 +153,49 @@ TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldIgnoreFileOnce")
     thread.join();
 }
 
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldNameEntryAndIgnoreItOnceInWatchedDirectory")
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchDirectory({testDirectory_, Event::close_write})
+        .ignoreOnce(testFileOne_)
+        .onEvent(Event::close_write, [&](Notification notification) { promisedOpen_.set_value(notification); });
+
+    openFile(testFileOne_);
+    openFile(testFileTwo_);
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    auto futureEvent = promisedOpen_.get_future();
+    CHECK(futureEvent.wait_for(timeout_) == std::future_status::ready);
+    CHECK(futureEvent.get().getPath() == testFileTwo_);
+    notifier.stop();
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldAddEventsToWatchedDirectory")
+{
+    std::promise<void> opened;
+    std::promise<void> written;
+    InotifyController notifier = InotifyController();
+    notifier.watchDirectory({testDirectory_, Event::close_write})
+        .watchDirectory({testDirectory_, Event::open})
+        .onEvent(Event::open, [&](Notification) { opened.set_value(); })
+        .onEvent(Event::close_write, [&](Notification) { written.set_value(); });
+
+    // the second watch keeps close_write of the first one
+    openFile(testFileOne_);
+
+    std::thread thread([&notifier]() {
+        notifier.runOnce();
+        notifier.runOnce();
+    });
+
+    CHECK(opened.get_future().wait_for(timeout_) == std::future_status::ready);
+    CHECK(written.get_future().wait_for(timeout_) == std::future_status::ready);
+    notifier.stop();
+    thread.join();
+}
+
 TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldIgnoreFile")
 {
     NotifyController notifier = InotifyController().ignore(testFileOne_).watchFile({testFileOne_, Event::close}).onEvent(Event::close, [&](Notification notification) {
@@ -192,6 +238,31 @@ TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldWatchPathRecursively")
     thread.join();
 }
 
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldWatchFilesBelowSubdirectoriesWithEventMask")
+{
+    std::filesystem::create_directories(recursiveTestDirectory_);
+    const auto nested = recursiveTestDirectory_ / "nested.txt";
+    std::ofstream(nested).close();
+
+    InotifyController notifier = InotifyController();
+    // subdirectories are skipped instead of rejected as files
+    CHECK_NOTHROW(notifier.watchPathRecursively({testDirectory_, Event::close_write}));
+    notifier.onUnexpectedEvent([&](Notification notification) { promisedOpen_.set_value(notification); });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(nested);
+
+    auto futureEvent = promisedOpen_.get_future();
+    CHECK(futureEvent.wait_for(timeout_) == std::future_status::ready);
+    const auto notification = futureEvent.get();
+    CHECK(notification.getPath() == nested);
+    CHECK(notification.getEvent() == Event::close_write);
+    notifier.stop();
+    thread.join();
+    std::filesystem::remove_all(recursiveTestDirectory_);
+}
+
 TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldUnwatchPath")
 {
     InotifyController notifier = InotifyController();
@@ -205,6 +276,26 @@ TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldUnwatchPath")
     thread.join();
 }
 
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldSkipEventsOfRemovedWatches")
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close_write})
+        .watchFile({testFileTwo_, Event::close_write})
+        .onEvent(Event::close_write, [&](Notification notification) { promisedOpen_.set_value(notification); });
+
+    // IN_IGNORED of the removed watch is read before the event of the second file
+    notifier.unwatch(testFileOne_);
+    openFile(testFileTwo_);
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    auto futureEvent = promisedOpen_.get_future();
+    CHECK(futureEvent.wait_for(timeout_) == std::future_status::ready);
+    CHECK(futureEvent.get().getPath() == testFileTwo_);
+    thread.join();
+    CHECK(notifier.getStats().eventsIgnored >= 1);
+}
+
 TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldCallUserDefinedUnexpectedExceptionObserver")
 {
     std::promise<void> observerCalled;
@@ -246,3 +337,218 @@ TEST_CASE_FIXTURE(FilesystemEventHelper, "countEvents")
     notifier.stop();
     thread.join();
 }
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldDispatchStaticallyBoundHandlers")
+{
+    size_t unexpected = 0;
+    auto notifier = makeNotifyController<Inotify>(
+        on<Event::close_write>([&](const Notification& notification) {
+            promisedCloseNoWrite_.set_value(notification);
+        }),
+        on<Event::attrib>([&](const Notification&) { ++unexpected; }));
+
+    notifier.watchFile({testFileOne_, Event::close_write});
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureClose = promisedCloseNoWrite_.get_future();
+    CHECK(futureClose.wait_for(timeout_) == std::future_status::ready);
+    CHECK_EQ(futureClose.get().getPath(), testFileOne_);
+    CHECK_EQ(unexpected, 0);
+    thread.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldRecordPipelineTiming")
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close}).onEvent(Event::close, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpenEvent = promisedOpen_.get_future();
+    CHECK(futureOpenEvent.wait_for(timeout_) == std::future_status::ready);
+    thread.join();
+
+#ifdef NOTIFYCPP_PIPELINE_TIMING
+    const auto* timing = notifier.getPipelineTiming();
+    REQUIRE(timing != nullptr);
+    CHECK(timing->getHistogram(PipelineStage::total).count() == 1);
+    CHECK(timing->getHistogram(PipelineStage::total).max() >= timing->getHistogram(PipelineStage::observer).max());
+#else
+    CHECK(notifier.getPipelineTiming() == nullptr);
+#endif
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldCountStatistics")
+{
+    InotifyController notifier = InotifyController();
+    notifier.watchFile({testFileOne_, Event::close}).onEvent(Event::close, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+    CHECK(notifier.getStats().activeWatches == 1);
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpenEvent = promisedOpen_.get_future();
+    CHECK(futureOpenEvent.wait_for(timeout_) == std::future_status::ready);
+    thread.join();
+
+    const NotifyStats stats = notifier.getStats();
+    CHECK(stats.syscalls >= 1);
+    CHECK(stats.bytesRead >= sizeof(inotify_event));
+    CHECK(stats.eventsDecoded >= 1);
+    CHECK(stats.queueHighWatermark >= 1);
+    CHECK(stats.overflows == 0);
+    CHECK(stats.observerInvocations == 1);
+
+    notifier.unwatch(testFileOne_);
+    CHECK(notifier.getStats().activeWatches == 0);
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldBusyPollWithinSpinBudget")
+{
+    InotifyController notifier = InotifyController();
+    notifier.setSpinBudget(std::chrono::seconds(5)).watchFile({testFileOne_, Event::close}).onEvent(Event::close, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    openFile(testFileOne_);
+
+    auto futureOpenEvent = promisedOpen_.get_future();
+    CHECK(futureOpenEvent.wait_for(timeout_) == std::future_status::ready);
+    thread.join();
+
+    const NotifyStats stats = notifier.getStats();
+    CHECK(stats.spinHits == 1);
+    CHECK(stats.spinReads >= 1);
+    CHECK(stats.spinNanoseconds > 0);
+    CHECK(stats.blockingWaits == 0);
+
+    // stop() ends a spin as well
+    std::thread spinning([&notifier]() { notifier.runOnce(); });
+    notifier.stop();
+    spinning.join();
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldDeduplicateOverlappingWatches")
+{
+    for (const bool deduplicate : { false, true }) {
+        InotifyController notifier = InotifyController();
+        std::atomic<std::size_t> written(0);
+        std::promise<void> first;
+        notifier.deduplicate(deduplicate)
+            .watchFile({testFileOne_, Event::close_write})
+            .watchDirectory({testDirectory_, Event::close_write})
+            .onEvent(Event::close_write, [&](Notification) {
+                if (written++ == 0)
+                    first.set_value();
+            });
+
+        std::thread thread([&notifier]() { notifier.run(); });
+
+        openFile(testFileOne_);
+
+        CHECK(first.get_future().wait_for(timeout_) == std::future_status::ready);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        notifier.stop();
+        thread.join();
+
+        // the file and its directory report the same close in one batch
+        CHECK(written == (deduplicate ? 1 : 2));
+        CHECK(notifier.getStats().eventsDeduplicated == (deduplicate ? 1 : 0));
+    }
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldProfileIfPerfEventsArePermitted")
+{
+    InotifyController notifier = InotifyController();
+    notifier.enableProfiling().watchFile({testFileOne_, Event::close}).onEvent(Event::close, [&](Notification notification) {
+        promisedOpen_.set_value(notification);
+    });
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(testFileOne_);
+
+    auto futureOpenEvent = promisedOpen_.get_future();
+    CHECK(futureOpenEvent.wait_for(timeout_) == std::future_status::ready);
+    thread.join();
+
+    // perf_event_open may be denied or without PMU, e.g. in a VM
+    const NotifyStats stats = notifier.getStats();
+    if (stats.profiling) {
+        CHECK(stats.profiledEvents == 1);
+        CHECK(stats.decodeCounters.instructions > 0);
+    }
+    else {
+        CHECK(stats.profiledEvents == 0);
+    }
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldMaintainTreeIndexFromEvents")
+{
+    std::filesystem::create_directories(recursiveTestDirectory_);
+    const auto created = recursiveTestDirectory_ / "created.txt";
+    std::filesystem::remove(created);
+
+    auto index = std::make_shared<TreeIndex>();
+    InotifyController notifier = InotifyController();
+    notifier.setTreeIndex(index)
+        .watchPathRecursively({ testDirectory_, Event::close_write })
+        .onEvent(Event::create, [&](Notification notification) { promisedOpen_.set_value(notification); });
+
+    CHECK(index->lookup(testFileOne_).has_value());
+    CHECK(index->lookup(recursiveTestDirectory_)->directory);
+    CHECK_FALSE(index->lookup(created).has_value());
+
+    std::thread thread([&notifier]() { notifier.runOnce(); });
+
+    openFile(created);
+
+    auto futureCreate = promisedOpen_.get_future();
+    CHECK(futureCreate.wait_for(timeout_) == std::future_status::ready);
+    CHECK(futureCreate.get().getPath() == created);
+    thread.join();
+
+    REQUIRE(index->lookup(created).has_value());
+    const auto entries = index->list(recursiveTestDirectory_);
+    CHECK(std::any_of(std::begin(entries), std::end(entries), [](const TreeEntry& entry) { return entry.name == "created.txt"; }));
+
+    std::filesystem::remove_all(recursiveTestDirectory_);
+}
+
+TEST_CASE_FIXTURE(FilesystemEventHelper, "shouldReportOfflineChangesFromSnapshot")
+{
+    const auto snapshot = std::filesystem::path("notifycpp_test.snapshot");
+    {
+        InotifyController notifier = InotifyController();
+        notifier.setTreeIndex(std::make_shared<TreeIndex>()).watchPathRecursively(testDirectory_).saveSnapshot(snapshot);
+    }
+
+    const auto offline = testDirectory_ / "offline.txt";
+    openFile(offline);
+
+    InotifyController notifier = InotifyController();
+    notifier.restoreSnapshot(snapshot, Event::close_write)
+        .onEvent(Event::create, [&](Notification notification) { promisedOpen_.set_value(notification); });
+
+    notifier.runOnce();
+    auto futureCreate = promisedOpen_.get_future();
+    REQUIRE(futureCreate.wait_for(timeout_) == std::future_status::ready);
+    CHECK(futureCreate.get().getPath() == offline);
+    CHECK(notifier.getTreeIndex()->lookup(offline).has_value());
+
+    std::filesystem::remove(offline);
+    std::filesystem::remove(snapshot);
+}
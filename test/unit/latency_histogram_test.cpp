@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/latency_histogram.h>
+#include <notify-cpp/pipeline_timing.h>
+
+#include "doctest.h"
+
+using namespace notifycpp;
+
+TEST_CASE("LatencyHistogramPercentileTest")
+{
+    LatencyHistogram histogram;
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.percentile(50) == 0);
+
+    for (std::uint64_t value = 1; value <= 1000000; ++value)
+        histogram.record(value);
+
+    CHECK(histogram.count() == 1000000);
+    CHECK(histogram.max() == 1000000);
+    CHECK(histogram.percentile(100) == 1000000);
+
+    // log-linear buckets keep the relative error below 1%
+    const auto p50 = histogram.percentile(50);
+    CHECK(p50 >= 500000);
+    CHECK(p50 <= 505000);
+    const auto p99 = histogram.percentile(99);
+    CHECK(p99 >= 990000);
+    CHECK(p99 <= 1000000);
+
+    histogram.reset();
+    CHECK(histogram.count() == 0);
+    CHECK(histogram.max() == 0);
+}
+
+TEST_CASE("LatencyHistogramExactSmallValuesTest")
+{
+    LatencyHistogram histogram;
+    for (std::uint64_t value = 0; value < 200; ++value)
+        histogram.record(value);
+
+    CHECK(histogram.percentile(50) == 99);
+    CHECK(histogram.max() == 199);
+}
+
+TEST_CASE("PipelineTimingStageTest")
+{
+    PipelineTiming timing;
+    PipelineTimestamps timestamps;
+    timestamps.read = 1000;
+    timestamps.decoded = 1100;
+    timestamps.enqueued = 1100;
+    timestamps.dispatched = 1500;
+    timing.record(timestamps, 1700);
+
+    CHECK(timing.getHistogram(PipelineStage::decode).max() == 100);
+    CHECK(timing.getHistogram(PipelineStage::queue).max() == 400);
+    CHECK(timing.getHistogram(PipelineStage::observer).max() == 200);
+    CHECK(timing.getHistogram(PipelineStage::total).max() == 700);
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/notify_stats.h>
+
+#include "doctest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace notifycpp;
+
+TEST_CASE("NotifyCountersSnapshotTest")
+{
+    NotifyCounters counters;
+    NotifyCounters::add(counters.syscalls);
+    NotifyCounters::add(counters.bytesRead, 64);
+    NotifyCounters::raise(counters.queueHighWatermark, 5);
+    NotifyCounters::raise(counters.queueHighWatermark, 3);
+    NotifyCounters::set(counters.activeWatches, 2);
+
+    const NotifyStats stats = counters.snapshot();
+    CHECK(stats.syscalls == 1);
+    CHECK(stats.bytesRead == 64);
+    CHECK(stats.queueHighWatermark == 5);
+    CHECK(stats.activeWatches == 2);
+    CHECK(stats.overflows == 0);
+}
+
+TEST_CASE("PrometheusExpositionTest")
+{
+    NotifyStats stats;
+    stats.eventsDecoded = 42;
+    stats.activeWatches = 3;
+
+    std::ostringstream out;
+    writePrometheus(out, stats);
+    const std::string text = out.str();
+
+    CHECK(text.find("# TYPE notifycpp_events_decoded_total counter\nnotifycpp_events_decoded_total 42\n") != std::string::npos);
+    CHECK(text.find("# TYPE notifycpp_watches gauge\nnotifycpp_watches 3\n") != std::string::npos);
+
+    const auto file = std::filesystem::temp_directory_path() / "notifycpp_stats_test.prom";
+    writePrometheus(file, stats);
+    std::ifstream in(file);
+    std::stringstream written;
+    written << in.rdbuf();
+    CHECK(written.str() == text);
+    std::filesystem::remove(file);
+}
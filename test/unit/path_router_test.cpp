@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/notify_controller.h>
+#include <notify-cpp/path_router.h>
+
+#include "doctest.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+TEST_CASE("shouldRouteEventsToAllPathPrefixes")
+{
+    PathRouter router;
+    std::vector<std::string> called;
+    const auto route = [&called](const std::string& name) { return [&called, name](Notification) { called.push_back(name); }; };
+
+    router.add("/", Event::all, route("root"));
+    router.add("/srv/tenant1", Event::modify, route("tenant1"));
+    router.add("/srv/tenant1/", Event::close, route("tenant1-close"));
+    router.add("/srv/tenant10", Event::all, route("tenant10"));
+    router.add("/srv/tenant1/logs/app.log", Event::all, route("file"));
+
+    CHECK(router.dispatch({ "/srv/tenant1/logs/app.log", Event::modify }) == 3);
+    CHECK(called == std::vector<std::string> { "root", "tenant1", "file" });
+
+    called.clear();
+    CHECK(router.dispatch({ "/srv/tenant1x/a", Event::close_write }) == 1);
+    CHECK(called == std::vector<std::string> { "root" });
+
+    called.clear();
+    CHECK(router.dispatch({ "/srv/tenant1//b", Event::close_write }) == 2);
+    CHECK(called == std::vector<std::string> { "root", "tenant1-close" });
+}
+
+TEST_CASE("shouldRejectRelativePathPrefixes")
+{
+    PathRouter router;
+    CHECK_THROWS_AS(router.add("srv/tenant1", Event::all, [](Notification) {}), std::invalid_argument);
+    CHECK_THROWS_AS(router.add("", Event::all, [](Notification) {}), std::invalid_argument);
+    CHECK(router.empty());
+
+    std::size_t called = 0;
+    router.add("/srv/tenant1", Event::all, [&called](Notification) { ++called; });
+    CHECK(router.dispatch({ "srv/tenant1/a", Event::modify }) == 0);
+    CHECK(router.dispatch({ "/srv/tenant1/a", Event::modify }) == 1);
+    CHECK(called == 1);
+}
+
+TEST_CASE("shouldFallBackToUnexpectedObserverWithoutRoute")
+{
+    FakeNotifyController notifier;
+    std::vector<std::string> routed;
+    std::vector<std::string> unexpected;
+    notifier.onPath("/fake/a", Event::modify, [&](Notification notification) { routed.push_back(notification.getPath()); })
+        .onUnexpectedEvent([&](Notification notification) { unexpected.push_back(notification.getPath()); });
+
+    auto& fake = notifier.getFakeNotify();
+    fake.inject({ "/fake/a/1", Event::modify });
+    fake.inject({ "/fake/b/1", Event::modify });
+    fake.inject({ "/fake/a/2", Event::open });
+    for (int i = 0; i < 3; ++i)
+        notifier.runOnce();
+
+    CHECK(routed == std::vector<std::string> { "/fake/a/1" });
+    CHECK(unexpected == std::vector<std::string> { "/fake/b/1", "/fake/a/2" });
+    CHECK(notifier.getStats().observerInvocations == 3);
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+
+#include <notify-cpp/notify_controller.h>
+#include <notify-cpp/thread_options.h>
+
+#include "doctest.h"
+
+#include <atomic>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+using namespace notifycpp;
+
+namespace {
+unsigned int firstAllowedCpu()
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+    for (unsigned int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set))
+            return cpu;
+    }
+    return 0;
+}
+
+int currentPolicy()
+{
+    int policy = -1;
+    sched_param param {};
+    pthread_getschedparam(pthread_self(), &policy, &param);
+    return policy;
+}
+}
+
+TEST_CASE("shouldPinThreadToCpu")
+{
+    const unsigned int cpu = firstAllowedCpu();
+    std::thread([cpu]() {
+        ThreadOptions options;
+        options.cpus = { cpu };
+        options.policy = SchedulingPolicy::batch;
+        applyThreadOptions(options);
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(0, sizeof(set), &set);
+        CHECK(CPU_COUNT(&set) == 1);
+        CHECK(CPU_ISSET(cpu, &set));
+        CHECK(sched_getcpu() == static_cast<int>(cpu));
+        CHECK(currentPolicy() == SCHED_BATCH);
+    }).join();
+}
+
+TEST_CASE("shouldRejectInvalidThreadOptions")
+{
+    std::thread([]() {
+        ThreadOptions options;
+        options.cpus = { CPU_SETSIZE };
+        CHECK_THROWS_AS(applyThreadOptions(options), std::runtime_error);
+        CHECK_FALSE(tryApplyThreadOptions(options));
+
+        ThreadOptions realtime;
+        realtime.policy = SchedulingPolicy::fifo;
+        realtime.priority = 0;
+        CHECK_FALSE(tryApplyThreadOptions(realtime));
+    }).join();
+}
+
+TEST_CASE("shouldPlaceReadBuffer")
+{
+    ReadBuffer buffer(65536);
+    CHECK(buffer.size() == 65536);
+    CHECK(reinterpret_cast<std::uintptr_t>(buffer.data()) % static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE)) == 0);
+    CHECK_FALSE(buffer.isLocked());
+
+    // RLIMIT_MEMLOCK may be too small without privileges
+    try {
+        buffer.place(true);
+        CHECK(buffer.isLocked());
+    }
+    catch (const std::runtime_error&) {
+        CHECK_FALSE(buffer.isLocked());
+    }
+
+    buffer.place(false);
+    CHECK_FALSE(buffer.isLocked());
+    CHECK(buffer.data()[65535] == 0);
+}
+
+TEST_CASE("shouldApplyControllerThreadOptions")
+{
+    const unsigned int cpu = firstAllowedCpu();
+
+    FakeNotifyController notifier;
+    ControllerThreadOptions options;
+    options.reader.cpus = { cpu };
+    options.workers.policy = SchedulingPolicy::batch;
+    notifier.setThreadOptions(options);
+
+    std::atomic<int> subscriberPolicy(-1);
+    auto subscriber = notifier.subscribe({}, [&](Notification) { subscriberPolicy = currentPolicy(); });
+
+    int readerCpu = -1;
+    notifier.onEvent(Event::modify, [&](Notification) { readerCpu = sched_getcpu(); });
+    notifier.getFakeNotify().inject({ "/fake/a", Event::modify });
+
+    std::thread([&notifier]() { notifier.runOnce(); }).join();
+    subscriber->close();
+
+    CHECK(readerCpu == static_cast<int>(cpu));
+    CHECK(subscriberPolicy == SCHED_BATCH);
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2019 Rafael Sadowski <rafael@sizeofvoid.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+#include <notify-cpp/tree_index.h>
+
+#include "doctest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace notifycpp;
+
+namespace {
+struct TreeDirectory {
+    TreeDirectory()
+        : root(std::filesystem::temp_directory_path() / "notifycpp_tree_index_test")
+    {
+        std::filesystem::remove_all(root);
+        std::filesystem::create_directories(root / "sub" / "deeper");
+        std::ofstream(root / "a.txt") << "a";
+        std::ofstream(root / "sub" / "b.txt") << "bb";
+    }
+
+    ~TreeDirectory()
+    {
+        std::filesystem::remove_all(root);
+    }
+
+    std::filesystem::path root;
+};
+
+std::vector<std::string> names(const std::vector<TreeEntry>& entries)
+{
+    std::vector<std::string> result;
+    for (const auto& entry : entries)
+        result.push_back(entry.name);
+    std::sort(std::begin(result), std::end(result));
+    return result;
+}
+}
+
+TEST_CASE_FIXTURE(TreeDirectory, "shouldIndexCrawledTree")
+{
+    TreeIndex index;
+    index.crawl(root);
+
+    CHECK(index.size() == 5);
+    CHECK(names(index.list(root)) == std::vector<std::string> { "a.txt", "sub" });
+    CHECK(names(index.list(root / "sub")) == std::vector<std::string> { "b.txt", "deeper" });
+
+    const auto b = index.lookup(root / "sub" / "b.txt");
+    REQUIRE(b.has_value());
+    CHECK(b->size == 2);
+    CHECK(b->inode != 0);
+    CHECK_FALSE(b->directory);
+    CHECK(index.lookup(root / "sub")->directory);
+
+    CHECK_FALSE(index.lookup(root / "missing").has_value());
+    CHECK(index.list(root / "a.txt").empty());
+    // components above the crawled root are not indexed
+    CHECK_FALSE(index.lookup(root.parent_path()).has_value());
+}
+
+TEST_CASE_FIXTURE(TreeDirectory, "shouldApplyEventsToIndex")
+{
+    TreeIndex index;
+    index.crawl(root);
+
+    std::ofstream(root / "sub" / "c.txt") << "ccc";
+    CHECK_FALSE(index.apply(FileSystemEvent(root / "sub" / "c.txt", Event::create)));
+    CHECK(index.lookup(root / "sub" / "c.txt")->size == 3);
+
+    std::ofstream(root / "a.txt") << "aaaa";
+    index.apply(FileSystemEvent(root / "a.txt", Event::close_write));
+    CHECK(index.lookup(root / "a.txt")->size == 4);
+
+    std::filesystem::create_directory(root / "new");
+    CHECK(index.apply(FileSystemEvent(root / "new", Event::create)));
+
+    std::filesystem::remove_all(root / "sub");
+    index.apply(FileSystemEvent(root / "sub", Event::delete_sub));
+    CHECK_FALSE(index.lookup(root / "sub" / "b.txt").has_value());
+    CHECK(names(index.list(root)) == std::vector<std::string> { "a.txt", "new" });
+    CHECK(index.size() == 3);
+
+    // removed nodes are reused
+    std::ofstream(root / "new" / "d.txt") << "d";
+    index.update(root / "new" / "d.txt");
+    CHECK(index.size() == 4);
+    CHECK(names(index.list(root / "new")) == std::vector<std::string> { "d.txt" });
+}
+
+TEST_CASE_FIXTURE(TreeDirectory, "shouldDiffSnapshotAgainstFilesystem")
+{
+    const auto snapshot = root.parent_path() / "notifycpp_tree_index_test.snapshot";
+    {
+        TreeIndex index;
+        index.crawl(root);
+        index.save(snapshot);
+    }
+
+    TreeIndex index;
+    index.load(snapshot);
+    std::filesystem::remove(snapshot);
+    CHECK(index.size() == 5);
+    CHECK(index.lookup(root / "sub" / "b.txt")->size == 2);
+    CHECK(names(index.list(root / "sub")) == std::vector<std::string> { "b.txt", "deeper" });
+
+    auto directories = index.getDirectories();
+    std::sort(std::begin(directories), std::end(directories));
+    CHECK(directories == std::vector<std::filesystem::path> { root, root / "sub", root / "sub" / "deeper" });
+
+    // changes while nobody was watching
+    std::ofstream(root / "a.txt") << "changed";
+    std::filesystem::remove(root / "sub" / "b.txt");
+    std::filesystem::create_directory(root / "offline");
+    std::ofstream(root / "offline" / "c.txt") << "c";
+
+    auto events = index.diffDirectory(root);
+    const auto sub = index.diffDirectory(root / "sub");
+    events.insert(std::end(events), std::begin(sub), std::end(sub));
+
+    const auto has = [&events](const std::filesystem::path& path, Event event) {
+        return std::any_of(std::begin(events), std::end(events),
+            [&](const FileSystemEvent& fse) { return fse.getPath() == path && fse.getEvent() == event; });
+    };
+    CHECK(events.size() == 4);
+    CHECK(has(root / "a.txt", Event::modify));
+    CHECK(has(root / "sub" / "b.txt", Event::delete_sub));
+    CHECK(has(root / "offline", Event::create));
+    CHECK(has(root / "offline" / "c.txt", Event::create));
+}
+
+TEST_CASE("shouldRejectInvalidSnapshot")
+{
+    const auto snapshot = std::filesystem::temp_directory_path() / "notifycpp_invalid.snapshot";
+    std::ofstream(snapshot) << "not a snapshot";
+
+    TreeIndex index;
+    CHECK_THROWS_AS(index.load(snapshot), std::runtime_error);
+    std::filesystem::remove(snapshot);
+}
+
+TEST_CASE_FIXTURE(TreeDirectory, "shouldKeepIndexIfSnapshotIsTruncated")
+{
+    const auto snapshot = root.parent_path() / "notifycpp_truncated.snapshot";
+    TreeIndex index;
+    index.crawl(root);
+    index.save(snapshot);
+    std::filesystem::resize_file(snapshot, std::filesystem::file_size(snapshot) - 1);
+
+    CHECK_THROWS_AS(index.load(snapshot), std::runtime_error);
+    CHECK(index.size() == 5);
+    CHECK(index.lookup(root / "sub" / "b.txt")->size == 2);
+
+    // a record count the file cannot hold
+    {
+        std::fstream file(snapshot, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8);
+        const std::uint32_t count = UINT32_MAX;
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    }
+    CHECK_THROWS_AS(index.load(snapshot), std::runtime_error);
+    CHECK(index.size() == 5);
+    std::filesystem::remove(snapshot);
+}
+
+TEST_CASE_FIXTURE(TreeDirectory, "shouldReuseNamesOfRemovedEntries")
+{
+    TreeIndex index;
+    for (int round = 0; round < 3; ++round) {
+        std::filesystem::create_directory(root / "churn");
+        for (int i = 0; i < 20; ++i)
+            std::ofstream(root / "churn" / (std::to_string(round) + "-" + std::to_string(i))) << "c";
+        index.crawl(root);
+        CHECK(index.size() == 26);
+        CHECK(index.list(root / "churn").size() == 20);
+        CHECK(index.lookup(root / "churn" / (std::to_string(round) + "-7")));
+
+        std::filesystem::remove_all(root / "churn");
+        index.remove(root / "churn");
+        CHECK(index.size() == 5);
+        CHECK(!index.lookup(root / "churn" / (std::to_string(round) + "-7")));
+    }
+    CHECK(names(index.list(root / "sub")) == std::vector<std::string> { "b.txt", "deeper" });
+}